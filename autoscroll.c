@@ -0,0 +1,690 @@
+#include "autoscroll.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline int min(int a, int b) { return a < b ? a : b; }
+static inline int max(int a, int b) { return a > b ? a : b; }
+static inline int sign(int a) {
+  if (a == 0)
+    return 0;
+  return (a < 0) ? -1 : 1;
+}
+
+static inline void post(struct autoscroll *as, struct scroll_cmd cmd) {
+  as->post(as->post_data, &cmd);
+}
+static inline void emit(struct autoscroll *as, int device, unsigned int type,
+                        unsigned int code, int value) {
+  post(as, (struct scroll_cmd){.kind = SCROLL_CMD_WRITE,
+                               .device = device,
+                               .type = type,
+                               .code = code,
+                               .value = value});
+}
+static inline void sleep_us(struct autoscroll *as, uint64_t us) {
+  post(as, (struct scroll_cmd){.kind = SCROLL_CMD_SLEEP, .time = us});
+}
+static inline void post_direction(struct autoscroll *as) {
+  post(as, (struct scroll_cmd){.kind = SCROLL_CMD_DIRECTION,
+                               .x = sign(as->dx),
+                               .y = sign(as->dy)});
+}
+static inline void post_reset(struct autoscroll *as) {
+  post(as, (struct scroll_cmd){.kind = SCROLL_CMD_RESET});
+}
+
+#define set_state(as, s) set_state_named(as, s, #s)
+static void set_state_named(struct autoscroll *as, int state,
+                            const char *name) {
+  as->state = state;
+  post(as, (struct scroll_cmd){.kind = SCROLL_CMD_STATE, .value = state});
+  if (as->verbose)
+    printf("state = %s\n", name);
+}
+
+static void accel_init(mouse_accel_t *accel,
+                       const struct autoscroll_params *params) {
+  mouse_accel_init(accel, params->dpi);
+  accel->threshold = params->accel_threshold;
+  accel->accel = params->accel_max;
+  accel->incline = params->accel_incline;
+  mouse_accel_set_profile_adaptive(accel);
+}
+
+void autoscroll_init(struct autoscroll *as,
+                     const struct autoscroll_params *params,
+                     void (*post)(void *data, const struct scroll_cmd *cmd),
+                     void *post_data) {
+  memset(as, 0, sizeof(*as));
+  as->params = *params;
+  as->post = post;
+  as->post_data = post_data;
+  as->btn_primary = BTN_LEFT;
+  as->btn_secondary = BTN_RIGHT;
+  as->wheel_hi_res = 1;
+  as->state = STATE_WAITING_FOR_SECONDARY_PRESS;
+  accel_init(&as->accel, params);
+}
+
+void scroller_init(struct scroller *sc, const struct autoscroll_params *params,
+                   const struct autoscroll_output *output) {
+  memset(sc, 0, sizeof(*sc));
+  sc->params = *params;
+  sc->output = *output;
+  sc->btn_secondary = BTN_RIGHT;
+  accel_init(&sc->accel, params);
+  mouse_accel_predictor_init(&sc->predictor, params->predict_alpha,
+                             params->predict_beta);
+}
+
+void autoscroll_scroll_multiple(struct autoscroll *as, int is_vertical,
+                                int value) {
+  if (as->verbose)
+    printf("scroll_mutiple(%d, %d)\n", is_vertical, value);
+
+  // emit(as, OUTPUT_MOUSE, EV_REL, is_vertical ? REL_WHEEL : REL_HWHEEL,
+  // value); emit(as, OUTPUT_MOUSE, EV_REL, is_vertical ? REL_WHEEL_HI_RES :
+  // REL_HWHEEL_HI_RES, 120 * value); emit(as, OUTPUT_MOUSE, EV_SYN,
+  // SYN_REPORT, 0);
+
+  sleep_us(as, 1000);
+  for (int i = 0; i < abs(value); i++) {
+    emit(as, OUTPUT_MOUSE, EV_REL, is_vertical ? REL_WHEEL : REL_HWHEEL,
+         1 * sign(value));
+    emit(as, OUTPUT_MOUSE, EV_REL,
+         is_vertical ? REL_WHEEL_HI_RES : REL_HWHEEL_HI_RES, 120 * sign(value));
+    emit(as, OUTPUT_MOUSE, EV_SYN, SYN_REPORT, 0);
+    if (as->verbose)
+      printf("Scrolling by one unit of 120\n");
+    sleep_us(as, 1000);
+  }
+}
+
+static void focus_window_under_cursor(struct autoscroll *as) {
+  // Hold Meta + Primary Click to focus window in GNOME
+  emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_LEFTMETA, 1);
+  emit(as, OUTPUT_KEYBOARD, EV_SYN, SYN_REPORT, 0);
+  emit(as, OUTPUT_MOUSE, EV_KEY, as->btn_primary, 1);
+  emit(as, OUTPUT_MOUSE, EV_SYN, SYN_REPORT, 0);
+  sleep_us(as, 1000);
+  emit(as, OUTPUT_MOUSE, EV_KEY, as->btn_primary, 0);
+  emit(as, OUTPUT_MOUSE, EV_SYN, SYN_REPORT, 0);
+  emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_LEFTMETA, 0);
+  emit(as, OUTPUT_KEYBOARD, EV_SYN, SYN_REPORT, 0);
+}
+
+static void back(struct autoscroll *as) {
+  if (as->verbose)
+    printf("back\n");
+  emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_LEFTALT, 1);
+  emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_LEFT, 1);
+  emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_LEFT, 0);
+  emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_LEFTALT, 0);
+  emit(as, OUTPUT_KEYBOARD, EV_SYN, SYN_REPORT, 0);
+}
+
+static inline void post_touch(struct autoscroll *as, int down) {
+  as->touching = down;
+  post(as, (struct scroll_cmd){.kind = SCROLL_CMD_TOUCH, .value = down});
+}
+
+static int handle_primary_press(struct autoscroll *as) {
+  as->primary_pressed = 1;
+
+  if (as->state == STATE_SCROLLING_WAITING) {
+    if (0) { // Trigger Kando menu
+      emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_LEFTMETA, 1);
+      emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_F12, 1);
+      emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_F12, 0);
+      emit(as, OUTPUT_KEYBOARD, EV_KEY, KEY_LEFTMETA, 0);
+      emit(as, OUTPUT_KEYBOARD, EV_SYN, SYN_REPORT, 0);
+      set_state(as, STATE_KANDO);
+      return HANDLE_EVENT_DROP;
+    } else {
+      // Trigger back button (repeatable)
+      back(as);
+      set_state(as, STATE_BACK);
+      return HANDLE_EVENT_DROP;
+    }
+  }
+  if (as->state == STATE_BACK) {
+    back(as);
+    return HANDLE_EVENT_DROP;
+  }
+  if (as->state == STATE_SCROLLING) {
+    // int is_vertical = abs(dir_y) >= abs(dir_x);
+    // autoscroll_scroll_multiple(as, is_vertical, 3 * (is_vertical ?
+    // sign(dir_y) : sign(dir_x)));
+    return HANDLE_EVENT_DROP;
+  }
+  if (as->params.touch) {
+    post_touch(as, 1);
+    return HANDLE_EVENT_DROP;
+  }
+
+  return HANDLE_EVENT_REEMIT;
+}
+static int handle_primary_release(struct autoscroll *as) {
+  as->primary_pressed = 0;
+  if (as->touching) {
+    post_touch(as, 0);
+    return HANDLE_EVENT_DROP;
+  }
+  return HANDLE_EVENT_REEMIT;
+}
+
+static int handle_secondary_press(struct autoscroll *as,
+                                  uint64_t timestamp_us) {
+  as->secondary_pressed = 1;
+  as->dx = 0;
+  as->dy = 0;
+  as->dir_x = 0;
+  as->dir_y = 0;
+  as->travel = 0;
+  as->last_moved = timestamp_us;
+  post_reset(as);
+  post_direction(as);
+
+  set_state(as, STATE_SCROLLING_WAITING);
+  return HANDLE_EVENT_DROP;
+}
+static int handle_secondary_release(struct autoscroll *as,
+                                    uint64_t timestamp_us) {
+  as->secondary_pressed = 0;
+
+  if (as->state == STATE_BACK) {
+    set_state(as, STATE_WAITING_FOR_SECONDARY_PRESS);
+    return HANDLE_EVENT_DROP;
+  }
+  if (as->state == STATE_KANDO) {
+    set_state(as, STATE_WAITING_FOR_SECONDARY_PRESS);
+    return HANDLE_EVENT_DROP;
+  }
+  if (as->state == STATE_KANDO_MOVED) {
+    emit(as, OUTPUT_MOUSE, EV_KEY, as->btn_primary, 0);
+    set_state(as, STATE_WAITING_FOR_SECONDARY_PRESS);
+    return HANDLE_EVENT_DROP;
+  }
+
+  if (as->state == STATE_SCROLLING) {
+    as->dx = 0;
+    as->dy = 0;
+    post_direction(as);
+    set_state(as, STATE_WAITING_FOR_SECONDARY_PRESS);
+    return HANDLE_EVENT_DROP;
+  }
+
+  if (as->state == STATE_SCROLLING_WAITING) { // Press secondary button and
+                                              // re-emit the release
+    emit(as, OUTPUT_MOUSE, EV_KEY, as->btn_secondary, 1);
+    post(as,
+         (struct scroll_cmd){.kind = SCROLL_CMD_CLICK, .time = timestamp_us});
+    set_state(as, STATE_WAITING_FOR_SECONDARY_PRESS);
+    return HANDLE_EVENT_DROP;
+  }
+  return HANDLE_EVENT_DROP;
+}
+
+static int handle_move(struct autoscroll *as, int is_vertical, int value,
+                       uint64_t timestamp_us) {
+  mouse_accel_t *accel = &as->accel;
+  as->last_moved = timestamp_us;
+
+  if (as->touching) { // the pointer still moves with the touch
+    post(as, (struct scroll_cmd){.kind = SCROLL_CMD_TOUCH_MOVE,
+                                 .x = is_vertical ? 0 : value,
+                                 .y = is_vertical ? value : 0});
+  }
+
+  if (is_vertical) {
+    as->dir_y += value;
+    as->dir_y = sign(as->dir_y) * min(10, abs(as->dir_y));
+    as->dir_x = sign(as->dir_x) * max(0, abs(as->dir_x) - abs(value));
+  } else {
+    as->dir_x += value;
+    as->dir_x = sign(as->dir_x) * min(10, abs(as->dir_x));
+    as->dir_y = sign(as->dir_y) * max(0, abs(as->dir_y) - abs(value));
+  }
+
+  mouse_accel_feed(accel, is_vertical ? 0 : value, is_vertical ? value : 0,
+                   timestamp_us);
+  double velocity =
+      mouse_accel_trackers_velocity(&accel->trackers, timestamp_us);
+  double accel_factor = mouse_accel_profile(accel, velocity);
+  if (as->params.predictive) {
+    post(as, (struct scroll_cmd){
+                 .kind = SCROLL_CMD_PREDICT,
+                 .amount = mouse_accel_trackers_velocity_recent(
+                     &accel->trackers, as->params.predict_points),
+                 .time = timestamp_us});
+  }
+  // printf("velocity_us: %.6f | velocity_ms: %.6f | Accel factor: %.6f\n",
+  //        velocity, velocity * 1000, accel_factor);
+
+  if (as->state == STATE_KANDO) {
+    emit(as, OUTPUT_MOUSE, EV_KEY, as->btn_primary, 1);
+    set_state(as, STATE_KANDO_MOVED);
+    return HANDLE_EVENT_REEMIT;
+  }
+  if (as->state == STATE_KANDO_MOVED) {
+    return HANDLE_EVENT_REEMIT;
+  }
+
+  if (as->state == STATE_SCROLLING_WAITING) {
+    as->travel += abs(value);
+    if (as->travel <= as->params.deadzone)
+      return HANDLE_EVENT_DROP;
+  }
+
+  if (as->state == STATE_SCROLLING_WAITING || as->state == STATE_SCROLLING) {
+    // printf("accel_factor: %.2f\n", accel_factor);
+    if (abs(as->dir_y) >= abs(as->dir_x)) {
+      if (sign(as->dy) != sign(as->dir_y)) {
+        as->dy = 0;
+        post_reset(as);
+      }
+      as->dy += value * accel_factor * 1.5;
+      as->dx = 0;
+    } else {
+      if (sign(as->dx) != sign(as->dir_x)) {
+        as->dx = 0;
+        post_reset(as);
+      }
+      as->dx += value * accel_factor;
+      as->dy = 0;
+    }
+    post_direction(as);
+    post(as, (struct scroll_cmd){.kind = SCROLL_CMD_BOOST,
+                                 .amount = abs(value) * accel_factor,
+                                 .factor = accel_factor});
+    // printf("dy=%d; dir_y=%d\n", dy, dir_y);
+  }
+
+  if (as->state == STATE_SCROLLING_WAITING) {
+    set_state(as, STATE_SCROLLING);
+    post(as,
+         (struct scroll_cmd){.kind = SCROLL_CMD_START, .time = timestamp_us});
+
+    return HANDLE_EVENT_DROP;
+  }
+
+  if (as->state == STATE_SCROLLING) {
+    return HANDLE_EVENT_DROP;
+  }
+
+  return HANDLE_EVENT_REEMIT;
+}
+
+// value in REL_WHEEL_HI_RES units
+static int handle_scroll(struct autoscroll *as, int is_vertical, int value,
+                         uint64_t timestamp_us) {
+  // printf("Scroll (%2d)\n", value);
+  focus_window_under_cursor(as);
+  if (as->params.smooth_wheel) {
+    // Same signs as the scroller's scroll_x, scroll_y
+    post(as, (struct scroll_cmd){.kind = SCROLL_CMD_WHEEL,
+                                 .x = is_vertical ? 0 : value,
+                                 .y = is_vertical ? -value : 0,
+                                 .time = timestamp_us});
+  }
+  return HANDLE_EVENT_DROP;
+}
+
+static int dispatch_event(struct autoscroll *as, const struct input_event *ev,
+                          uint64_t timestamp_us) {
+  int r = HANDLE_EVENT_REEMIT;
+  if (ev->type == EV_KEY && ev->code == as->btn_primary) {
+    if (ev->value)
+      r = handle_primary_press(as);
+    else
+      r = handle_primary_release(as);
+  } else if (ev->type == EV_KEY && ev->code == as->btn_secondary) {
+    if (ev->value)
+      r = handle_secondary_press(as, timestamp_us);
+    else
+      r = handle_secondary_release(as, timestamp_us);
+  } else if (ev->type == EV_REL) {
+    if (ev->code == REL_X || ev->code == REL_Y)
+      r = handle_move(as, ev->code == REL_Y, ev->value, timestamp_us);
+    else if (ev->code == REL_WHEEL_HI_RES || ev->code == REL_HWHEEL_HI_RES)
+      r = handle_scroll(as, ev->code == REL_WHEEL_HI_RES, ev->value,
+                        timestamp_us);
+    else if ((ev->code == REL_WHEEL || ev->code == REL_HWHEEL) &&
+             !as->wheel_hi_res && as->params.smooth_wheel)
+      r = handle_scroll(as, ev->code == REL_WHEEL, 120 * ev->value,
+                        timestamp_us);
+    else if (ev->code == REL_WHEEL || ev->code == REL_HWHEEL)
+      r = HANDLE_EVENT_DROP;
+  } else if (ev->type == MSC_SCAN) {
+    r = HANDLE_EVENT_DROP;
+  }
+  return r;
+}
+
+// Debouncing
+
+static struct debounce *debounced_button(struct autoscroll *as,
+                                         const struct input_event *ev) {
+  if (as->params.debounce_us <= 0 || ev->type != EV_KEY ||
+      ev->code < BTN_MOUSE || ev->code >= BTN_MOUSE + DEBOUNCE_BUTTONS)
+    return NULL;
+  return &as->debounce[ev->code - BTN_MOUSE];
+}
+
+static void debounce_check_at(struct autoscroll *as, struct debounce *b,
+                              uint64_t t) {
+  if (!b->due_us || t < b->due_us)
+    b->due_us = t;
+  if (!as->debounce_due_us || t < as->debounce_due_us)
+    as->debounce_due_us = t;
+}
+
+// Button b released and pressed again within the window at t
+static void debounce_bounced(struct autoscroll *as, struct debounce *b,
+                             uint64_t t) {
+  if (!b->chatters && as->verbose)
+    printf("Button %d chatters, holding back its releases\n",
+           BTN_MOUSE + (int)(b - as->debounce));
+  b->chatters = 1;
+  b->chatter_us = t;
+}
+
+// Whether to hold back a release of button b at t for the window: a bounce
+// would end the scroll it holds, or it bounced lately
+static int debounce_holds_release(struct autoscroll *as, struct debounce *b,
+                                  uint64_t t) {
+  if (as->state == STATE_SCROLLING &&
+      b == &as->debounce[as->btn_secondary - BTN_MOUSE])
+    return 1;
+  if (b->chatters && (int64_t)(t - b->chatter_us) >= DEBOUNCE_CHATTER_US) {
+    b->chatters = 0;
+    if (as->verbose)
+      printf("Button %d stopped chattering\n",
+             BTN_MOUSE + (int)(b - as->debounce));
+  }
+  return b->chatters;
+}
+
+// Whether to pass on an edge of button b read at t. Corrections are stamped
+// with the time they were due, so an event read after one can be older than
+// the last edge; that counts as inside the window.
+static int debounce_filter(struct autoscroll *as, struct debounce *b,
+                           int value, uint64_t t) {
+  int64_t window = as->params.debounce_us;
+  int64_t since_edge = (int64_t)(t - b->edge_us);
+  int raw = value != 0;
+  // Pressed again while a release after the window is held back
+  if (raw && !b->raw && b->down && since_edge >= window)
+    debounce_bounced(as, b, t);
+  b->raw = raw;
+  if (b->raw == b->down)
+    return 0; // back where it was, or a repeat
+  if (since_edge < window) {
+    debounce_check_at(as, b, b->edge_us + window);
+    return 0;
+  }
+  if (!b->raw && debounce_holds_release(as, b, t)) {
+    debounce_check_at(as, b, t + window);
+    return 0;
+  }
+  b->down = b->raw;
+  b->edge_us = t;
+  return 1;
+}
+
+// Pass on the state of buttons that ended up different from what was
+// passed on, once their window is over
+static void debounce_settle(struct autoscroll *as, uint64_t now) {
+  if (!as->debounce_due_us || now < as->debounce_due_us)
+    return;
+  as->debounce_due_us = 0;
+  for (int i = 0; i < DEBOUNCE_BUTTONS; i++) {
+    struct debounce *b = &as->debounce[i];
+    if (!b->due_us)
+      continue;
+    if (now < b->due_us) {
+      debounce_check_at(as, b, b->due_us);
+      continue;
+    }
+    // now is a tick's clock reading, not an event time, stamp with due_us
+    uint64_t due = b->due_us;
+    b->due_us = 0;
+    if (b->raw == b->down)
+      continue;
+    if (b->raw) // released, then pressed again
+      debounce_bounced(as, b, due);
+    b->down = b->raw;
+    b->edge_us = due;
+    struct input_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.time.tv_sec = due / 1000000;
+    ev.time.tv_usec = due % 1000000;
+    ev.type = EV_KEY;
+    ev.code = BTN_MOUSE + i;
+    ev.value = b->raw;
+    if (dispatch_event(as, &ev, due) == HANDLE_EVENT_REEMIT) {
+      emit(as, OUTPUT_MOUSE, EV_KEY, ev.code, ev.value);
+      emit(as, OUTPUT_MOUSE, EV_SYN, SYN_REPORT, 0);
+    }
+  }
+}
+
+void autoscroll_tick(struct autoscroll *as, uint64_t now_us) {
+  debounce_settle(as, now_us);
+}
+
+void autoscroll_handle_event(struct autoscroll *as,
+                             const struct input_event *ev) {
+  uint64_t timestamp_us = ev->time.tv_usec + 1000000 * ev->time.tv_sec;
+
+  debounce_settle(as, timestamp_us);
+  struct debounce *b = debounced_button(as, ev);
+  if (b && !debounce_filter(as, b, ev->value, timestamp_us))
+    return;
+
+  if (dispatch_event(as, ev, timestamp_us) == HANDLE_EVENT_REEMIT) {
+    emit(as, OUTPUT_MOUSE, ev->type, ev->code, ev->value);
+  }
+}
+
+static inline void sc_emit(struct scroller *sc, int device, unsigned int type,
+                           unsigned int code, int value) {
+  sc->output.write(sc->output.data, device, type, code, value);
+}
+
+static void wheel_notch(struct wheel_anim *w,
+                        const struct autoscroll_params *p, double amount,
+                        uint64_t t) {
+  if (amount == 0)
+    return;
+  double remaining = w->distance - w->done;
+  if (remaining * amount < 0) // reversed: stop, no momentum
+    remaining = 0;
+  if (remaining != 0 && t - w->last_notch_us < p->wheel_duration_us)
+    w->gain = fmin(p->wheel_accel_max,
+                   w->gain * pow(p->wheel_accel, fabs(amount) / 120));
+  else
+    w->gain = 1;
+  w->distance = remaining + amount * w->gain;
+  w->done = 0;
+  w->start_us = t;
+  w->last_notch_us = t;
+}
+
+// Hi-res units to scroll this tick, ease-out cubic
+static double wheel_step(struct wheel_anim *w,
+                         const struct autoscroll_params *p, uint64_t t) {
+  if (w->distance == 0)
+    return 0;
+  double u = t > w->start_us ? (t - w->start_us) / p->wheel_duration_us : 0;
+  double pos = w->distance;
+  if (u < 1)
+    pos *= 1 - (1 - u) * (1 - u) * (1 - u);
+  double step = pos - w->done;
+  w->done = pos;
+  if (u >= 1)
+    w->distance = w->done = 0;
+  return step;
+}
+
+static void touch_flush(struct scroller *sc) {
+  if (!sc->touch_dx && !sc->touch_dy)
+    return;
+  sc_emit(sc, OUTPUT_TOUCH, EV_REL, REL_X, sc->touch_dx);
+  sc_emit(sc, OUTPUT_TOUCH, EV_REL, REL_Y, sc->touch_dy);
+  sc_emit(sc, OUTPUT_TOUCH, EV_SYN, SYN_REPORT, 0);
+  sc->touch_dx = sc->touch_dy = 0;
+}
+
+void scroller_apply(struct scroller *sc, const struct scroll_cmd *cmd) {
+  switch (cmd->kind) {
+  case SCROLL_CMD_WRITE:
+    sc_emit(sc, cmd->device, cmd->type, cmd->code, cmd->value);
+    break;
+  case SCROLL_CMD_SLEEP:
+    sc->output.sleep_us(sc->output.data, cmd->time);
+    break;
+  case SCROLL_CMD_DIRECTION:
+    sc->dir_x = cmd->x;
+    sc->dir_y = cmd->y;
+    break;
+  case SCROLL_CMD_BOOST:
+    // The default path clamps through int max() as it always has, which
+    // truncates the boost to whole units; -p keeps the fraction.
+    if (sc->params.predictive)
+      sc->vel_boost =
+          fmax(0, sc->vel_boost + cmd->amount - sc->params.boost_loss);
+    else
+      sc->vel_boost =
+          max(0, sc->vel_boost + cmd->amount - sc->params.boost_loss);
+    sc->accel_factor = cmd->factor;
+    break;
+  case SCROLL_CMD_RESET:
+    sc->vel_boost = 0;
+    sc->predicted_boost = 0;
+    mouse_accel_predictor_reset(&sc->predictor);
+    break;
+  case SCROLL_CMD_START:
+    sc->scroll_start_us = cmd->time;
+    break;
+  case SCROLL_CMD_PREDICT:
+    mouse_accel_predictor_feed(&sc->predictor, cmd->amount, cmd->time);
+    break;
+  case SCROLL_CMD_CLICK:
+    sc->click_secondary_pressed_at_us = cmd->time;
+    break;
+  case SCROLL_CMD_STATE:
+    sc->state = cmd->value;
+    break;
+  case SCROLL_CMD_TOUCH:
+    touch_flush(sc); // a release goes after the last move
+    sc_emit(sc, OUTPUT_TOUCH, EV_KEY, BTN_TOUCH, cmd->value);
+    sc_emit(sc, OUTPUT_TOUCH, EV_SYN, SYN_REPORT, 0);
+    break;
+  case SCROLL_CMD_TOUCH_MOVE:
+    sc->touch_dx += cmd->x;
+    sc->touch_dy += cmd->y;
+    break;
+  case SCROLL_CMD_WHEEL:
+    wheel_notch(&sc->wheel_x, &sc->params, cmd->x, cmd->time);
+    wheel_notch(&sc->wheel_y, &sc->params, cmd->y, cmd->time);
+    break;
+  }
+}
+
+void scroller_post(void *data, const struct scroll_cmd *cmd) {
+  scroller_apply(data, cmd);
+}
+
+void scroller_tick(struct scroller *sc, uint64_t t) {
+  const struct autoscroll_params *p = &sc->params;
+  int do_syn = 0;
+
+  if (sc->click_secondary_pressed_at_us > 0 &&
+      (t - sc->click_secondary_pressed_at_us) > CLICK_SECONDARY_DELAY_US) {
+    sc->click_secondary_pressed_at_us = 0;
+    sc_emit(sc, OUTPUT_MOUSE, EV_KEY, sc->btn_secondary, 0);
+    do_syn = 1;
+  }
+
+  if (sc->last_tick_us == 0)
+    sc->last_tick_us = t;
+
+  uint64_t delta_us = t - sc->last_tick_us;
+  // printf("Timer tick: Δt = %llu µs\n", (unsigned long long)delta_us);
+
+  double f = (double)delta_us / 1000.0;
+
+  double vel_update_rate =
+      p->vel_update_rate *
+      fmin(1, (double)(t - sc->scroll_start_us) / p->vel_ramp_us);
+
+  double target_vel = p->base_vel + (sc->vel_boost * p->boost_vel);
+
+  if (p->predictive) {
+    // Aim for the speed the hand will be at when this frame is shown: the
+    // vel_boost that the predicted hand velocity settles at. vel_boost
+    // itself still carries the momentum once the hand stops. The prediction
+    // is eased like the velocity, so noise between events is filtered and a
+    // step starts gently instead of at full acceleration.
+    double v = mouse_accel_predictor_predict(
+        &sc->predictor, t + TICK_INTERVAL_US, TICK_INTERVAL_US);
+    double events_per_ms =
+        sc->predictor.interval > 0 ? 1000.0 / sc->predictor.interval : 0;
+    double boost_input = v_us2ms(v) * (p->dpi / 1000.0) *
+                             mouse_accel_profile(&sc->accel, v) -
+                         p->boost_loss * events_per_ms;
+    double predicted_boost = fmax(0, boost_input) / p->boost_decay;
+    vel_update_rate = fmin(p->predict_vel_update_rate, 1 / f);
+    sc->predicted_boost +=
+        (vel_update_rate * f) * (predicted_boost - sc->predicted_boost);
+    target_vel = p->base_vel +
+                 (fmax(sc->vel_boost, sc->predicted_boost) * p->boost_vel);
+  }
+
+  sc->target_vel_y = sc->dir_y * target_vel;
+  sc->vel_y =
+      sc->vel_y + (vel_update_rate * f) * (sc->target_vel_y - sc->vel_y);
+  sc->scroll_y += sc->vel_y * f;
+
+  sc->target_vel_x = sc->dir_x * target_vel;
+  sc->vel_x =
+      sc->vel_x + (vel_update_rate * f) * (sc->target_vel_x - sc->vel_x);
+  sc->scroll_x += sc->vel_x * f;
+
+  // printf("vel_boost: %.2f\n", vel_boost);
+
+  sc->vel_boost = sc->vel_boost + (p->boost_decay * f) * (0 - sc->vel_boost);
+
+  // Smooth wheel shares the integrator, on top of any autoscroll
+  sc->scroll_x += wheel_step(&sc->wheel_x, p, t);
+  sc->scroll_y += wheel_step(&sc->wheel_y, p, t);
+
+  // printf("vel_y: %.2f\n", vel_y);
+  if (abs(sc->scroll_y) >= 1) {
+    double scroll_value = trunc(sc->scroll_y);
+    sc->scroll_y = sc->scroll_y - scroll_value;
+    sc_emit(sc, OUTPUT_MOUSE, EV_REL, REL_WHEEL_HI_RES, -(int)scroll_value);
+    do_syn = 1;
+  }
+  if (abs(sc->scroll_x) >= 1) {
+    double scroll_value = trunc(sc->scroll_x);
+    sc->scroll_x = sc->scroll_x - scroll_value;
+    sc_emit(sc, OUTPUT_MOUSE, EV_REL, REL_HWHEEL_HI_RES, (int)scroll_value);
+    do_syn = 1;
+  }
+  if (do_syn)
+    sc_emit(sc, OUTPUT_MOUSE, EV_SYN, SYN_REPORT, 0);
+
+  // At most one touch move per frame, on the tick nearest to it
+  if ((sc->touch_dx || sc->touch_dy) &&
+      t - sc->touch_sent_us + TICK_INTERVAL_US / 2 >= p->touch_frame_us) {
+    touch_flush(sc);
+    sc->touch_sent_us = t;
+  }
+
+  sc->last_tick_us = t;
+  if (sc->on_tick)
+    sc->on_tick(sc->on_tick_data, sc, t);
+}
@@ -0,0 +1,234 @@
+#ifndef AUTOSCROLL_H
+#define AUTOSCROLL_H
+
+// Event handling core, without any device I/O. All time comes from the
+// caller (event timestamps and tick() arguments, in CLOCK_MONOTONIC
+// microseconds), so the same code runs in the daemon and in offline
+// simulations. Nothing here allocates.
+//
+// It is split in two halves that only talk through struct scroll_cmd:
+// - struct autoscroll: the state machine, fed device events.
+// - struct scroller: the scroll integrator and frame clock side, which owns
+//   the output devices (struct autoscroll_output).
+// Single-threaded users pass scroller_post() as the state machine's post
+// callback; the threaded pipeline puts a queue in between (pipeline.h).
+
+#include "pointer_accel.h"
+#include <linux/input.h>
+#include <stdint.h>
+
+#define HANDLE_EVENT_REEMIT 0
+#define HANDLE_EVENT_DROP 1
+
+#define TICK_INTERVAL_US 8000
+#define CLICK_SECONDARY_DELAY_US 20000
+#define DPI 1000
+
+#define STATE_WAITING_FOR_SECONDARY_PRESS 0
+#define STATE_SCROLLING_WAITING 1
+#define STATE_SCROLLING 2
+#define STATE_SCROLLING_DISCRETE 3
+#define STATE_ACTION_WAITING 4
+#define STATE_KANDO 5
+#define STATE_KANDO_MOVED 6
+#define STATE_BACK 10
+
+// Output devices
+#define OUTPUT_MOUSE 0
+#define OUTPUT_KEYBOARD 1
+#define OUTPUT_TOUCH 2 // BTN_TOUCH, then REL_X/REL_Y + SYN_REPORT per move
+
+// Device writes and blocking waits, done by the scroller
+struct autoscroll_output {
+  void (*write)(void *data, int device, unsigned int type, unsigned int code,
+                int value);
+  void (*sleep_us)(void *data, uint64_t us);
+  void *data;
+};
+
+struct autoscroll_params {
+  int deadzone; // travel (counts) before a held secondary button scrolls
+  int dpi;
+
+  // Scroll velocity, in REL_WHEEL_HI_RES units per ms
+  double base_vel;        // while holding still
+  double boost_vel;       // per unit of vel_boost
+  double boost_decay;     // vel_boost decay, per ms
+  double boost_loss;      // subtracted from vel_boost on every move event
+  double vel_update_rate; // how fast velocity follows the target, per ms
+  double vel_ramp_us;     // vel_update_rate ramps up over this long
+
+  // Acceleration profile, see pointer_accel.h
+  double accel_threshold;
+  double accel_max;
+  double accel_incline;
+
+  // Predictive scrolling
+  int predictive;
+  double predict_alpha;
+  double predict_beta;
+  int predict_points;
+  double predict_vel_update_rate;
+
+  // Smooth wheel: every wheel notch (120 hi-res units) is scrolled over
+  // wheel_duration_us, easing out. Notches less than that apart multiply
+  // the next ones by wheel_accel each, up to wheel_accel_max.
+  int smooth_wheel;
+  double wheel_duration_us;
+  double wheel_accel;
+  double wheel_accel_max;
+
+  // Touch emulation: the primary button drives OUTPUT_TOUCH instead, with
+  // moves coalesced to one per touch_frame_us (rounded to ticks)
+  int touch;
+  double touch_frame_us;
+
+  // Button debouncing, 0 to disable: the first edge of a button goes through
+  // at once, further edges within debounce_us of it are dropped. A button
+  // found in another state when the window ends is corrected then.
+  // Releases are held back for the window while the button holds a scroll,
+  // and for DEBOUNCE_CHATTER_US after the button last bounced.
+  double debounce_us;
+};
+
+#define AUTOSCROLL_DEFAULT_PARAMS                                              \
+  {                                                                            \
+    .deadzone = 0, .dpi = DPI, .base_vel = 1.2, .boost_vel = 0.1,              \
+    .boost_decay = 0.01, .boost_loss = 0.5, .vel_update_rate = 0.02,           \
+    .vel_ramp_us = 100 * 1000,                                                 \
+    .accel_threshold = MOUSE_ACCEL_DEFAULT_THRESHOLD,                          \
+    .accel_max = MOUSE_ACCEL_DEFAULT_ACCELERATION,                             \
+    .accel_incline = MOUSE_ACCEL_DEFAULT_INCLINE, .predictive = 0,             \
+    .predict_alpha = 0.2, .predict_beta = 0.05, .predict_points = 16,          \
+    .predict_vel_update_rate = 0.03, .smooth_wheel = 0,                        \
+    .wheel_duration_us = 200 * 1000, .wheel_accel = 1.25,                      \
+    .wheel_accel_max = 4, .touch = 0, .touch_frame_us = 16667,                 \
+    .debounce_us = 0,                                                          \
+  }
+
+// Commands from the state machine to the scroller
+#define SCROLL_CMD_WRITE 0       // write device, type, code, value
+#define SCROLL_CMD_SLEEP 1       // block the output side for time us
+#define SCROLL_CMD_DIRECTION 2   // scroll towards sign x, y (0: stop)
+#define SCROLL_CMD_BOOST 3       // add amount to vel_boost
+#define SCROLL_CMD_RESET 4       // drop vel_boost and the prediction
+#define SCROLL_CMD_START 5       // scrolling started at time
+#define SCROLL_CMD_PREDICT 6     // hand velocity amount at time
+#define SCROLL_CMD_CLICK 7       // secondary button was pressed at time
+#define SCROLL_CMD_STATE 8       // state machine is now in state value
+#define SCROLL_CMD_WHEEL 9       // wheel scrolled by hi-res x, y at time
+#define SCROLL_CMD_TOUCH 10      // touch down (value 1) or up (value 0)
+#define SCROLL_CMD_TOUCH_MOVE 11 // touch moved by x, y
+
+struct scroll_cmd {
+  int kind;
+  int device;
+  unsigned short type, code;
+  int value;
+  int x, y;
+  double amount;
+  double factor; // BOOST: acceleration factor included in amount
+  uint64_t time;
+};
+
+// Debouncing state of one button, see autoscroll_params.debounce_us
+struct debounce {
+  int down;            // as passed on
+  int raw;             // as last read
+  uint64_t edge_us;    // last edge passed on, corrections at their due_us
+  uint64_t due_us;     // compare raw and down then, 0 if not needed
+  int chatters;        // released and pressed again within the window lately
+  uint64_t chatter_us; // last time it did
+};
+
+#define DEBOUNCE_BUTTONS 8          // BTN_LEFT (BTN_MOUSE) to BTN_TASK
+#define DEBOUNCE_CHATTER_US 3000000 // chatters clears this long after a bounce
+
+struct autoscroll {
+  struct autoscroll_params params;
+  void (*post)(void *data, const struct scroll_cmd *cmd);
+  void *post_data;
+  int btn_primary;
+  int btn_secondary;
+  int verbose;      // print state changes
+  int wheel_hi_res; // device has REL_WHEEL_HI_RES, else use REL_WHEEL
+
+  mouse_accel_t accel;
+  int primary_pressed;
+  int secondary_pressed;
+  int touching;
+  int state;
+  int dx, dy;
+  int dir_x, dir_y;
+  int travel;
+  uint64_t last_moved;
+
+  struct debounce debounce[DEBOUNCE_BUTTONS];
+  uint64_t debounce_due_us; // earliest pending correction, 0 if none
+};
+
+// A smooth wheel scroll in progress, on one axis
+struct wheel_anim {
+  double distance; // hi-res units to scroll since start_us
+  double done;     // part of distance already scrolled
+  uint64_t start_us;
+  uint64_t last_notch_us;
+  double gain; // momentum
+};
+
+struct scroller {
+  struct autoscroll_params params;
+  struct autoscroll_output output;
+  int btn_secondary;
+
+  mouse_accel_t accel; // only for its profile
+  mouse_accel_predictor_t predictor;
+  uint64_t click_secondary_pressed_at_us;
+  int dir_x, dir_y;
+  double scroll_x, scroll_y;
+  double vel_x, vel_y;
+  double target_vel_x, target_vel_y;
+  double vel_boost;
+  double predicted_boost; // smoothed, predictive mode only
+  struct wheel_anim wheel_x, wheel_y;
+  int touch_dx, touch_dy; // not sent yet
+  uint64_t touch_sent_us;
+  uint64_t last_tick_us;
+  uint64_t scroll_start_us;
+
+  // For monitoring only
+  int state;           // as last posted by the state machine
+  double accel_factor; // of the last scrolling move
+  // Called at the end of every tick, may be NULL
+  void (*on_tick)(void *data, const struct scroller *sc, uint64_t now_us);
+  void *on_tick_data;
+};
+
+void autoscroll_init(struct autoscroll *as,
+                     const struct autoscroll_params *params,
+                     void (*post)(void *data, const struct scroll_cmd *cmd),
+                     void *post_data);
+
+// Handle one device event, re-emitting it if it is not consumed
+void autoscroll_handle_event(struct autoscroll *as,
+                             const struct input_event *ev);
+
+// Pass on debounced button edges that are due. Call every tick when
+// debounce_us is set, on the thread that handles events.
+void autoscroll_tick(struct autoscroll *as, uint64_t now_us);
+
+void autoscroll_scroll_multiple(struct autoscroll *as, int is_vertical,
+                                int value);
+
+void scroller_init(struct scroller *sc, const struct autoscroll_params *params,
+                   const struct autoscroll_output *output);
+
+void scroller_apply(struct scroller *sc, const struct scroll_cmd *cmd);
+
+// Post callback for struct autoscroll, data is a struct scroller
+void scroller_post(void *data, const struct scroll_cmd *cmd);
+
+// Advance the scroll integrator to `now_us`, emitting any scrolling
+void scroller_tick(struct scroller *sc, uint64_t now_us);
+
+#endif
@@ -1,4 +1,5 @@
-#include <dbus/dbus.h>
+#include "dbus.h"
+#include <linux/input.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -8,7 +9,30 @@ DBusMessage *msg;
 DBusMessageIter args;
 dbus_uint32_t serial = 0;
 
-void connect_dbus()
+// Touch output since the last SYN_REPORT
+int touch_dx, touch_dy;
+
+static void out_of_memory()
+{
+    fprintf(stderr, "Out Of Memory!\n");
+    exit(1);
+}
+
+static DBusMessage *new_touch_message(const char *method)
+{
+    DBusMessage *m = dbus_message_new_method_call(
+        TOUCH_DESTINATION, TOUCH_PATH, TOUCH_INTERFACE, method);
+    if (!m)
+    {
+        fprintf(stderr, "Message Null\n");
+        exit(1);
+    }
+    // Don't make the shell send replies nobody reads
+    dbus_message_set_no_reply(m, TRUE);
+    return m;
+}
+
+int connect_dbus()
 {
     dbus_error_init(&err);
 
@@ -17,41 +41,92 @@ void connect_dbus()
     {
         fprintf(stderr, "DBus: Connection Error (%s)\n", err.message);
         dbus_error_free(&err);
+        conn = NULL;
+        return -1;
     }
+    dbus_connection_set_exit_on_disconnect(conn, FALSE);
+    return 0;
 }
 
-void send_dbus_message(const char *method)
+// Sending already writes out as much as the socket takes right now, without
+// blocking. Whatever is left goes out with the next message or touch_tick().
+static void send_nonblocking(DBusMessage *m)
 {
-    msg = dbus_message_new_method_call(
-        "org.gnome.Shell",
-        "/com/github/entibo/clicktotouch",
-        "com.github.entibo.clicktotouch",
-        method);
+    if (!dbus_connection_send(conn, m, &serial))
+        out_of_memory();
+    dbus_message_unref(m);
+}
 
-    if (!msg)
-    {
-        fprintf(stderr, "Message Null\n");
-        exit(1);
-    }
+// Write out what is left and drop what came in (NameAcquired, ...), nothing
+// is handled here. Once per touch, the socket is not polled per move.
+static void service_connection()
+{
+    dbus_connection_read_write(conn, 0);
+    DBusMessage *incoming;
+    while ((incoming = dbus_connection_pop_message(conn)))
+        dbus_message_unref(incoming);
+}
 
-    if (!dbus_connection_send(conn, msg, &serial))
-    {
-        fprintf(stderr, "Out Of Memory!\n");
-        exit(1);
-    }
-    dbus_connection_flush(conn);
+void send_dbus_message(const char *method)
+{
+    if (!conn)
+        return;
 
-    printf("Sent message with serial %u\n", serial);
+    msg = new_touch_message(method);
+    send_nonblocking(msg);
 
-    // Free message
-    dbus_message_unref(msg);
+    printf("Sent message with serial %u\n", serial);
 }
 
 void touch_press()
 {
-    send_dbus_message("Press");
+    if (!conn)
+        return;
+    send_nonblocking(new_touch_message("Press"));
+    printf("Sent Press with serial %u\n", serial);
 }
 void touch_release()
 {
-    send_dbus_message("Release");
-}
\ No newline at end of file
+    if (!conn)
+        return;
+    send_nonblocking(new_touch_message("Release"));
+    service_connection();
+    printf("Sent Release with serial %u\n", serial);
+}
+void touch_move(int dx, int dy)
+{
+    if (!conn)
+        return;
+    DBusMessage *m = new_touch_message("Move");
+    dbus_int32_t x = dx, y = dy;
+    if (!dbus_message_append_args(m, DBUS_TYPE_INT32, &x, DBUS_TYPE_INT32, &y,
+                                  DBUS_TYPE_INVALID))
+        out_of_memory();
+    send_nonblocking(m);
+}
+
+void touch_tick()
+{
+    if (conn && dbus_connection_has_messages_to_send(conn))
+        dbus_connection_read_write(conn, 0);
+}
+
+void touch_write(unsigned int type, unsigned int code, int value)
+{
+    if (type == EV_KEY && code == BTN_TOUCH)
+    {
+        if (value)
+            touch_press();
+        else
+            touch_release();
+    }
+    else if (type == EV_REL && code == REL_X)
+        touch_dx += value;
+    else if (type == EV_REL && code == REL_Y)
+        touch_dy += value;
+    else if (type == EV_SYN && (touch_dx || touch_dy))
+    {
+        touch_move(touch_dx, touch_dy);
+        touch_dx = touch_dy = 0;
+    }
+}
@@ -1,9 +1,20 @@
-
-#ifndef DBUS_H
-#define DBUS_H
+#ifndef AUTOSCROLL_DBUS_H
+#define AUTOSCROLL_DBUS_H
 #include <dbus/dbus.h>
-void connect_dbus();
+
+// Method calls to the GNOME Shell extension
+#define TOUCH_DESTINATION "org.gnome.Shell"
+#define TOUCH_PATH "/com/github/entibo/clicktotouch"
+#define TOUCH_INTERFACE "com.github.entibo.clicktotouch"
+
+int connect_dbus();
 void send_dbus_message(const char *method);
 void touch_press();
 void touch_release();
-#endif
\ No newline at end of file
+void touch_move(int dx, int dy);
+// Every frame, on the thread that sends: write out a message the socket
+// only took part of, instead of leaving it until the next one
+void touch_tick();
+// OUTPUT_TOUCH events (see autoscroll.h) to Press, Move(dx, dy), Release
+void touch_write(unsigned int type, unsigned int code, int value);
+#endif
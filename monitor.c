@@ -0,0 +1,83 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "monitor.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int monitor_open(struct monitor *m) {
+  memset(m, 0, sizeof(*m));
+
+  // A new file rather than truncating the old one, which would fault
+  // readers that still have it mapped. They notice the updates stopping and
+  // reopen.
+  unlink(MONITOR_PATH);
+  int fd = open(MONITOR_PATH, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    perror(MONITOR_PATH);
+    return -1;
+  }
+  fchmod(fd, 0644); // readable by overlays running as the user
+  if (ftruncate(fd, sizeof(*m->shm)) < 0) {
+    perror(MONITOR_PATH);
+    close(fd);
+    return -1;
+  }
+  m->shm = mmap(NULL, sizeof(*m->shm), PROT_READ | PROT_WRITE, MAP_SHARED,
+                fd, 0);
+  close(fd);
+  if (m->shm == MAP_FAILED) {
+    perror("mmap");
+    m->shm = NULL;
+    return -1;
+  }
+
+  m->shm->version = MONITOR_VERSION;
+  m->shm->size = sizeof(*m->shm);
+  m->shm->pid = getpid();
+  // Magic last, readers ignore the file until it is set
+  atomic_thread_fence(memory_order_release);
+  m->shm->magic = MONITOR_MAGIC;
+  return 0;
+}
+
+void monitor_publish(void *data, const struct scroller *sc, uint64_t now_us) {
+  struct monitor *m = data;
+  struct monitor_shm *shm = m->shm;
+  struct monitor_state *s = &shm->state;
+
+  uint64_t delta = s->tick_us ? now_us - s->tick_us : 0;
+  if (now_us - m->window_start_us >= 1000000) {
+    m->prev_window_delta_max_us = m->window_delta_max_us;
+    m->window_delta_max_us = 0;
+    m->window_start_us = now_us;
+  }
+  if (delta > m->window_delta_max_us)
+    m->window_delta_max_us = delta;
+
+  // Only this thread writes, so a plain increment of seq is enough
+  uint32_t seq = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+  atomic_store_explicit(&shm->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  s->state = sc->state;
+  s->dir_x = sc->dir_x;
+  s->dir_y = sc->dir_y;
+  s->vel_x = sc->vel_x;
+  s->vel_y = sc->vel_y;
+  s->target_vel_x = sc->target_vel_x;
+  s->target_vel_y = sc->target_vel_y;
+  s->vel_boost = sc->vel_boost;
+  s->accel_factor = sc->accel_factor;
+  s->ticks++;
+  s->tick_us = now_us;
+  s->tick_delta_us = delta;
+  s->tick_delta_max_us = m->window_delta_max_us > m->prev_window_delta_max_us
+                             ? m->window_delta_max_us
+                             : m->prev_window_delta_max_us;
+
+  atomic_store_explicit(&shm->seq, seq + 2, memory_order_release);
+}
@@ -0,0 +1,65 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+// Live state export for overlays and monitors. The daemon keeps a struct
+// monitor_shm in a file under /dev/shm and updates it once per tick, inside
+// a seqlock. Readers map the file and copy the struct out at any rate,
+// without syscalls and without ever blocking the daemon:
+//
+//   do {
+//     seq = atomic_load_explicit(&shm->seq, memory_order_acquire);
+//     copy = shm->state;
+//     atomic_thread_fence(memory_order_acquire);
+//   } while ((seq & 1) ||
+//            seq != atomic_load_explicit(&shm->seq, memory_order_relaxed));
+//
+// See tools/autoscroll-monitor.c.
+
+#include "autoscroll.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define MONITOR_PATH "/dev/shm/mouse-autoscroll"
+#define MONITOR_MAGIC 0x6d617363 // "masc"
+#define MONITOR_VERSION 1
+
+struct monitor_state {
+  int32_t state; // STATE_*, see autoscroll.h
+  int32_t dir_x, dir_y;
+  int32_t pad;
+  // Scroll velocity, in REL_WHEEL_HI_RES units per ms
+  double vel_x, vel_y;
+  double target_vel_x, target_vel_y;
+  double vel_boost;
+  double accel_factor; // of the last scrolling move
+
+  // Ticks, CLOCK_MONOTONIC microseconds
+  uint64_t ticks;
+  uint64_t tick_us;           // time of the last tick
+  uint64_t tick_delta_us;     // since the tick before
+  uint64_t tick_delta_max_us; // over the last 1-2 s
+};
+
+struct monitor_shm {
+  uint32_t magic;
+  uint32_t version; // new fields only ever go at the end of state
+  uint32_t size;    // sizeof(struct monitor_shm) of the writer
+  uint32_t pid;
+  _Atomic uint32_t seq; // odd while an update is in progress
+  uint32_t pad;
+  struct monitor_state state;
+};
+
+struct monitor {
+  struct monitor_shm *shm;
+  uint64_t window_start_us;
+  uint64_t window_delta_max_us, prev_window_delta_max_us;
+};
+
+// Create the file, replacing any previous one. Returns -1 on error.
+int monitor_open(struct monitor *m);
+
+// struct scroller on_tick callback, data is a struct monitor
+void monitor_publish(void *data, const struct scroller *sc, uint64_t now_us);
+
+#endif
@@ -1,7 +1,10 @@
 #define _POSIX_C_SOURCE 200809L
 
+#include "autoscroll.h"
 #include "dbus.h"
-#include "pointer_accel.h"
+#include "monitor.h"
+#include "pipeline.h"
+#include "uring.h"
 #include <errno.h>
 #include <fcntl.h>
 #include <libevdev/libevdev-uinput.h>
@@ -15,36 +18,20 @@
 #include <time.h>
 #include <unistd.h>
 
-#define HANDLE_EVENT_REEMIT 0
-#define HANDLE_EVENT_DROP 1
-
-#define DEADZONE 15
-#define TICK_INTERVAL_US 8000
-#define CLICK_SECONDARY_DELAY_US 20000
-#define DPI 1000
-
 int btn_primary = BTN_LEFT;
 int btn_secondary = BTN_RIGHT;
+int predictive_scroll = 0;
+int threaded = 0;
+int use_uring = 0;
+int smooth_wheel = 0;
+int touch = 0;
+int debounce_ms = 0;
 
 static inline uint64_t now_us(void) {
   static struct timespec ts;
   clock_gettime(CLOCK_MONOTONIC, &ts);
   return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000ull;
 }
-static inline void sleep_ms(int ms) {
-  static struct timespec ts;
-  ts.tv_sec = 0;
-  ts.tv_nsec = ms * 1000 * 1000;
-  nanosleep(&ts, NULL);
-}
-
-static inline int min(int a, int b) { return a < b ? a : b; }
-static inline int max(int a, int b) { return a > b ? a : b; }
-static inline int sign(int a) {
-  if (a == 0)
-    return 0;
-  return (a < 0) ? -1 : 1;
-}
 
 struct libevdev_uinput *mouse_uinput;
 struct libevdev_uinput *keyboard_uinput;
@@ -110,374 +97,100 @@ struct libevdev_uinput *new_keyboard_uinput() {
   return uinput;
 }
 
-void scroll_multiple(int is_vertical, int value) {
-  printf("scroll_mutiple(%d, %d)\n", is_vertical, value);
-
-  // libevdev_uinput_write_event(mouse_uinput, EV_REL, is_vertical ? REL_WHEEL :
-  // REL_HWHEEL, value); libevdev_uinput_write_event(mouse_uinput, EV_REL,
-  // is_vertical ? REL_WHEEL_HI_RES : REL_HWHEEL_HI_RES, 120 * value);
-  // libevdev_uinput_write_event(mouse_uinput, EV_SYN, SYN_REPORT, 0);
-
-  struct timespec ts;
-  ts.tv_sec = 0;
-  ts.tv_nsec = 1 * 1 * 1000 * 1000;
-  nanosleep(&ts, NULL);
-  for (int i = 0; i < abs(value); i++) {
-    libevdev_uinput_write_event(mouse_uinput, EV_REL,
-                                is_vertical ? REL_WHEEL : REL_HWHEEL,
-                                1 * sign(value));
-    libevdev_uinput_write_event(
-        mouse_uinput, EV_REL,
-        is_vertical ? REL_WHEEL_HI_RES : REL_HWHEEL_HI_RES, 120 * sign(value));
-    libevdev_uinput_write_event(mouse_uinput, EV_SYN, SYN_REPORT, 0);
-    printf("Scrolling by one unit of 120\n");
-    nanosleep(&ts, NULL);
-  }
+struct autoscroll as;
+struct scroller scroller;
+struct pipeline pipeline;
+struct uring_loop loop;
+struct monitor monitor;
+int monitoring; // monitor_open() succeeded
+
+void uinput_write(void *data, int device, unsigned int type, unsigned int code,
+                  int value) {
+  libevdev_uinput_write_event(device == OUTPUT_KEYBOARD ? keyboard_uinput
+                                                        : mouse_uinput,
+                              type, code, value);
 }
 
-//
-
-#define STATE_WAITING_FOR_SECONDARY_PRESS 0
-#define STATE_SCROLLING_WAITING 1
-#define STATE_SCROLLING 2
-#define STATE_SCROLLING_DISCRETE 3
-#define STATE_ACTION_WAITING 4
-#define STATE_KANDO 5
-#define STATE_KANDO_MOVED 6
-#define STATE_BACK 10
-
-mouse_accel_t accel;
-int primary_pressed = 0;
-int secondary_pressed = 0;
-uint64_t click_secondary_pressed_at_us = 0;
-int state = STATE_WAITING_FOR_SECONDARY_PRESS;
-int dx = 0, dy = 0;
-int dir_x = 0, dir_y = 0;
-double scroll_x = 0, scroll_y = 0;
-double vel_x = 0, vel_y = 0;
-double vel_boost = 0;
-uint64_t time_accumulator_us = 0;
-uint64_t last_moved = 0;
-uint64_t scroll_start_us = 0;
-
-double delta_to_scroll_speed(double v) {
-  // v = v - DEADZONE;
-  if (v <= 0)
-    return 0;
-  return 0.8;
-  if (v < 50)
-    return 0.7;
-  return 0.7 + (v - 50) / 50;
-  // if (v < 150)
-  //     return 5;
-  // return 10;
-}
-
-void tick() {
-  int do_syn = 0;
-  static uint64_t last = 0;
-  uint64_t t = now_us();
-
-  if (click_secondary_pressed_at_us > 0 &&
-      (t - click_secondary_pressed_at_us) > CLICK_SECONDARY_DELAY_US) {
-    click_secondary_pressed_at_us = 0;
-    libevdev_uinput_write_event(mouse_uinput, EV_KEY, btn_secondary, 0);
-    do_syn = 1;
-  }
-
-  if (last == 0)
-    last = t;
-
-  uint64_t delta_us = t - last;
-  // printf("Timer tick: Δt = %llu µs\n", (unsigned long long)delta_us);
-
-  double f = (double)delta_us / 1000.0;
-
-  if (0 && f >= 5) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-
-    char buf[100];
-    // Example: "2025-09-26 14:35:12"
-    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", t);
-
-    printf("%s: Timer interval was %.1f time slower than expected!\n", buf, f);
-  }
-
-  double vel_update_rate =
-      0.02 * fmin(1, (double)(t - scroll_start_us) / (double)(100 * 1000));
-
-  double target_vel = 1.2 + (vel_boost * 0.1);
+// Mouse and keyboard output, uinput_write() or uring_loop_write()
+void (*device_write)(void *data, int device, unsigned int type,
+                     unsigned int code, int value) = uinput_write;
 
-  double target_vel_y = dy == 0 ? 0 : sign(dy) * target_vel;
-  vel_y = vel_y + (vel_update_rate * f) * ((double)(target_vel_y)-vel_y);
-  scroll_y += vel_y * f;
-
-  double target_vel_x = dx == 0 ? 0 : sign(dx) * target_vel;
-  vel_x = vel_x + (vel_update_rate * f) * ((double)(target_vel_x)-vel_x);
-  scroll_x += vel_x * f;
-
-  // printf("vel_boost: %.2f\n", vel_boost);
-
-  vel_boost = vel_boost + (0.01 * f) * (0 - vel_boost);
-
-  // printf("vel_y: %.2f\n", vel_y);
-  // printf("scroll_y: (before) %.2f (after) %.2f (+= %.2f) | scroll by %d\n",
-  //        scroll_y, scroll_y - trunc(scroll_y), vel_y * f,
-  //        (int)trunc(scroll_y));
-  if (abs(scroll_y) >= 1) {
-    double scroll_value = trunc(scroll_y);
-    scroll_y = scroll_y - scroll_value;
-    libevdev_uinput_write_event(mouse_uinput, EV_REL, REL_WHEEL_HI_RES,
-                                -(int)scroll_value);
-    do_syn = 1;
-  }
-  if (abs(scroll_x) >= 1) {
-    double scroll_value = trunc(scroll_x);
-    scroll_x = scroll_x - scroll_value;
-    libevdev_uinput_write_event(mouse_uinput, EV_REL, REL_HWHEEL_HI_RES,
-                                (int)scroll_value);
-    do_syn = 1;
-  }
-  if (do_syn)
-    libevdev_uinput_write_event(mouse_uinput, EV_SYN, SYN_REPORT, 0);
-
-  last = t;
+void output_write(void *data, int device, unsigned int type, unsigned int code,
+                  int value) {
+  if (device == OUTPUT_TOUCH)
+    touch_write(type, code, value);
+  else
+    device_write(data, device, type, code, value);
 }
 
-void focus_window_under_cursor() {
-  // Hold Meta + Primary Click to focus window in GNOME
-
+void uinput_sleep(void *data, uint64_t us) {
   struct timespec ts;
-  ts.tv_sec = 0;
-  ts.tv_nsec = 1 * 1 * 1000 * 1000;
-
-  libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_LEFTMETA, 1);
-  libevdev_uinput_write_event(keyboard_uinput, EV_SYN, SYN_REPORT, 0);
-  libevdev_uinput_write_event(mouse_uinput, EV_KEY, btn_primary, 1);
-  libevdev_uinput_write_event(mouse_uinput, EV_SYN, SYN_REPORT, 0);
+  ts.tv_sec = us / 1000000;
+  ts.tv_nsec = (us % 1000000) * 1000;
   nanosleep(&ts, NULL);
-  libevdev_uinput_write_event(mouse_uinput, EV_KEY, btn_primary, 0);
-  libevdev_uinput_write_event(mouse_uinput, EV_SYN, SYN_REPORT, 0);
-  libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_LEFTMETA, 0);
-  libevdev_uinput_write_event(keyboard_uinput, EV_SYN, SYN_REPORT, 0);
-}
-
-void back() {
-  printf("back\n");
-  libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_LEFTALT, 1);
-  libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_LEFT, 1);
-  libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_LEFT, 0);
-  libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_LEFTALT, 0);
-  libevdev_uinput_write_event(keyboard_uinput, EV_SYN, SYN_REPORT, 0);
 }
 
-int handle_primary_press() {
-  primary_pressed = 1;
-
-  if (state == STATE_SCROLLING_WAITING) {
-    if (0) { // Trigger Kando menu
-      libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_LEFTMETA, 1);
-      libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_F12, 1);
-      libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_F12, 0);
-      libevdev_uinput_write_event(keyboard_uinput, EV_KEY, KEY_LEFTMETA, 0);
-      libevdev_uinput_write_event(keyboard_uinput, EV_SYN, SYN_REPORT, 0);
-      state = STATE_KANDO;
-      printf("state = STATE_KANDO\n");
-      return HANDLE_EVENT_DROP;
-    } else {
-      // Trigger back button (repeatable)
-      back();
-      state = STATE_BACK;
-      printf("state = STATE_BACK\n");
-      return HANDLE_EVENT_DROP;
-    }
-  }
-  if (state == STATE_BACK) {
-    back();
-    return HANDLE_EVENT_DROP;
-  }
-  if (state == STATE_SCROLLING) {
-    // int is_vertical = abs(dir_y) >= abs(dir_x);
-    // scroll_multiple(is_vertical, 3 * (is_vertical ? sign(dir_y) :
-    // sign(dir_x)));
-    return HANDLE_EVENT_DROP;
-  }
-
-  return HANDLE_EVENT_REEMIT;
-}
-int handle_primary_release() {
-  primary_pressed = 0;
-  return HANDLE_EVENT_REEMIT;
-}
-
-int handle_secondary_press() {
-  secondary_pressed = 1;
-  dx = 0;
-  dy = 0;
-  vel_boost = 0;
-  dir_x = 0;
-  dir_y = 0;
-  last_moved = now_us();
-
-  state = STATE_SCROLLING_WAITING;
-  printf("state = STATE_SCROLLING_WAITING\n");
-  return HANDLE_EVENT_DROP;
-}
-int handle_secondary_release() {
-  secondary_pressed = 0;
-
-  if (state == STATE_BACK) {
-    state = STATE_WAITING_FOR_SECONDARY_PRESS;
-    printf("state = STATE_WAITING_FOR_SECONDARY_PRESS\n");
-    return HANDLE_EVENT_DROP;
-  }
-  if (state == STATE_KANDO) {
-    state = STATE_WAITING_FOR_SECONDARY_PRESS;
-    printf("state = STATE_WAITING_FOR_SECONDARY_PRESS\n");
-    return HANDLE_EVENT_DROP;
-  }
-  if (state == STATE_KANDO_MOVED) {
-    libevdev_uinput_write_event(mouse_uinput, EV_KEY, btn_primary, 0);
-    state = STATE_WAITING_FOR_SECONDARY_PRESS;
-    printf("state = STATE_WAITING_FOR_SECONDARY_PRESS\n");
-    return HANDLE_EVENT_DROP;
-  }
-
-  if (state == STATE_SCROLLING) {
-    dx = 0;
-    dy = 0;
-    state = STATE_WAITING_FOR_SECONDARY_PRESS;
-    printf("state = STATE_WAITING_FOR_SECONDARY_PRESS\n");
-    return HANDLE_EVENT_DROP;
-  }
-
-  if (state == STATE_SCROLLING_WAITING) { // Press secondary button and re-emit
-                                          // the release
-    libevdev_uinput_write_event(mouse_uinput, EV_KEY, btn_secondary, 1);
-    click_secondary_pressed_at_us = now_us();
-    state = STATE_WAITING_FOR_SECONDARY_PRESS;
-    printf("state = STATE_WAITING_FOR_SECONDARY_PRESS\n");
-    return HANDLE_EVENT_DROP;
-  }
-  return HANDLE_EVENT_DROP;
+// io_uring loop callbacks
+void loop_event(void *data, const struct input_event *ev) {
+  autoscroll_handle_event(&as, ev);
 }
 
-int handle_move(int is_vertical, int value, uint64_t timestamp_us) {
-  last_moved = now_us();
-
-  if (is_vertical) {
-    dir_y += value;
-    dir_y = sign(dir_y) * min(10, abs(dir_y));
-    dir_x = sign(dir_x) * max(0, abs(dir_x) - abs(value));
-  } else {
-    dir_x += value;
-    dir_x = sign(dir_x) * min(10, abs(dir_x));
-    dir_y = sign(dir_y) * max(0, abs(dir_y) - abs(value));
-  }
+void loop_flush(void *data) { pipeline_flush(&pipeline); }
 
-  mouse_accel_feed(&accel, is_vertical ? 0 : value, is_vertical ? value : 0,
-                   timestamp_us);
-  double velocity =
-      mouse_accel_trackers_velocity(&accel.trackers, timestamp_us);
-  double accel_factor = mouse_accel_profile_linear(&accel, velocity);
-  // printf("velocity_us: %.6f | velocity_ms: %.6f | Accel factor: %.6f\n",
-  //        velocity, velocity * 1000, accel_factor);
-
-  if (state == STATE_KANDO) {
-    libevdev_uinput_write_event(mouse_uinput, EV_KEY, btn_primary, 1);
-    state = STATE_KANDO_MOVED;
-    printf("state = STATE_KANDO_MOVED\n");
-    return HANDLE_EVENT_REEMIT;
-  }
-  if (state == STATE_KANDO_MOVED) {
-    return HANDLE_EVENT_REEMIT;
-  }
-
-  if (state == STATE_SCROLLING_WAITING || state == STATE_SCROLLING) {
-    // printf("accel_factor: %.2f\n", accel_factor);
-    if (abs(dir_y) >= abs(dir_x)) {
-      if (sign(dy) != sign(dir_y)) {
-        dy = 0;
-        vel_boost = 0;
-      }
-      dy += value * accel_factor * 1.5;
-      // scroll_y += value * accel_factor * 1;
-      dx = 0;
-    } else {
-      if (sign(dx) != sign(dir_x)) {
-        dx = 0;
-        vel_boost = 0;
-      }
-      dx += value * accel_factor;
-      // scroll_x += value * accel_factor * 1;
-      dy = 0;
-    }
-    vel_boost = max(0, vel_boost + abs(value) * accel_factor - 0.5);
-    // printf("dy=%d; dir_y=%d\n", dy, dir_y);
-  }
-
-  if (state == STATE_SCROLLING_WAITING) {
-    state = STATE_SCROLLING;
-    printf("state = STATE_SCROLLING\n");
-    time_accumulator_us = 0;
-    scroll_start_us = now_us();
-
-    return HANDLE_EVENT_DROP;
-  }
-
-  if (state == STATE_SCROLLING) {
-    return HANDLE_EVENT_DROP;
-  }
-
-  return HANDLE_EVENT_REEMIT;
+void loop_tick(void *data, uint64_t now) {
+  autoscroll_tick(&as, now);
+  scroller_tick(&scroller, now);
 }
 
-int handle_scroll(int is_vertical, int value) {
-  // printf("Scroll (%2d)\n", value);
-  focus_window_under_cursor();
-  return HANDLE_EVENT_DROP;
+// Reader thread ticks when threaded, only needed for debouncing
+void loop_debounce_tick(void *data, uint64_t now) {
+  autoscroll_tick(&as, now);
+  pipeline_flush(&pipeline);
 }
 
-//
-
-void handle_mouse_event(struct input_event *ev) {
-  uint64_t timestamp_us = ev->time.tv_usec + 1000000 * ev->time.tv_sec;
-  // printf("%ld\n", timestamp_us);
-
-  int r = HANDLE_EVENT_REEMIT;
-  if (ev->type == EV_KEY && ev->code == btn_primary) {
-    if (ev->value)
-      r = handle_primary_press();
-    else
-      r = handle_primary_release();
-  } else if (ev->type == EV_KEY && ev->code == btn_secondary) {
-    if (ev->value)
-      r = handle_secondary_press();
-    else
-      r = handle_secondary_release();
-  } else if (ev->type == EV_REL) {
-    if (ev->code == REL_X || ev->code == REL_Y)
-      r = handle_move(ev->code == REL_Y, ev->value, timestamp_us);
-    else if (ev->code == REL_WHEEL_HI_RES || ev->code == REL_HWHEEL_HI_RES)
-      r = handle_scroll(ev->code == REL_WHEEL_HI_RES, ev->value);
-    else if (ev->code == REL_WHEEL || ev->code == REL_HWHEEL)
-      r = HANDLE_EVENT_DROP;
-  } else if (ev->type == MSC_SCAN) {
-    r = HANDLE_EVENT_DROP;
-  }
-  if (r == HANDLE_EVENT_REEMIT) {
-    libevdev_uinput_write_event(mouse_uinput, ev->type, ev->code, ev->value);
-  }
+// After every frame, on the thread that writes output
+void scroller_ticked(void *data, const struct scroller *sc, uint64_t now) {
+  if (monitoring)
+    monitor_publish(&monitor, sc, now);
+  if (touch)
+    touch_tick();
 }
 
 int main(int argc, char *argv[]) {
   // Read CLI arguments
-  if (argc < 2) {
-    printf("Usage: %s <dev_path>\n", argv[0]);
+  int opt;
+  while ((opt = getopt(argc, argv, "ptuwTd:")) != -1) {
+    switch (opt) {
+    case 'p':
+      predictive_scroll = 1;
+      break;
+    case 't':
+      threaded = 1;
+      break;
+    case 'u':
+      use_uring = 1;
+      break;
+    case 'w':
+      smooth_wheel = 1;
+      break;
+    case 'T':
+      touch = 1;
+      break;
+    case 'd':
+      debounce_ms = atoi(optarg);
+      break;
+    default:
+      printf("Usage: %s [-p] [-t] [-u] [-w] [-T] [-d ms] <dev_path>\n",
+             argv[0]);
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    printf("Usage: %s [-p] [-t] [-u] [-w] [-T] [-d ms] <dev_path>\n",
+           argv[0]);
     return 1;
   }
-  char *dev_path = argv[1];
+  char *dev_path = argv[optind];
 
   // Open device file directly
   int dev_fd = open(dev_path, O_RDONLY | O_NONBLOCK);
@@ -492,6 +205,9 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  // Event timestamps on the same clock as now_us()
+  libevdev_set_clock_id(evdev, CLOCK_MONOTONIC);
+
   // Get exclusive rights to this device's events
   if (ioctl(dev_fd, EVIOCGRAB, (void *)1) < 0) {
     fprintf(stderr, "Grab %s failed\n", dev_path);
@@ -503,35 +219,103 @@ int main(int argc, char *argv[]) {
   keyboard_uinput = new_keyboard_uinput();
 
   // Connect to GNOME extension using DBus
-  // connect_dbus();
+  if (touch && connect_dbus() < 0)
+    touch = 0;
+
+  // io_uring event loop, if asked for and available
+  if (use_uring) {
+    int out_fds[2];
+    out_fds[OUTPUT_MOUSE] = libevdev_uinput_get_fd(mouse_uinput);
+    out_fds[OUTPUT_KEYBOARD] = libevdev_uinput_get_fd(keyboard_uinput);
+    rc = uring_loop_init(&loop, dev_fd, out_fds);
+    if (rc < 0) {
+      fprintf(stderr, "io_uring unavailable (%s), using poll\n",
+              strerror(-rc));
+      use_uring = 0;
+    }
+  }
+
+  // Init the event handling core
+  struct autoscroll_params params = AUTOSCROLL_DEFAULT_PARAMS;
+  params.predictive = predictive_scroll;
+  params.smooth_wheel = smooth_wheel;
+  params.touch = touch;
+  params.debounce_us = debounce_ms * 1000;
+  struct autoscroll_output output = {output_write, uinput_sleep, NULL};
+  if (use_uring && !threaded) {
+    // Output goes through the ring too
+    device_write = uring_loop_write;
+    output.sleep_us = uring_loop_sleep;
+    output.data = &loop;
+  }
+  if (threaded) {
+    // The emitter thread owns the uinput devices and the frame clock
+    if (pipeline_init(&pipeline, &params, &output) < 0)
+      return 1;
+  } else {
+    scroller_init(&scroller, &params, &output);
+  }
+  struct scroller *sc = threaded ? &pipeline.scroller : &scroller;
+  sc->btn_secondary = btn_secondary;
 
-  // Init the acceleration thing
-  mouse_accel_init(&accel, DPI);
-  // mouse_accel_set_speed(&accel, 0.9); // ?
+  // Publish live state for monitors, see monitor.h
+  monitoring = monitor_open(&monitor) == 0;
+  sc->on_tick = scroller_ticked;
+
+  if (threaded) {
+    if (pipeline_start(&pipeline) < 0)
+      return 1;
+    autoscroll_init(&as, &params, pipeline_post, &pipeline);
+  } else {
+    autoscroll_init(&as, &params, scroller_post, &scroller);
+  }
+  as.btn_primary = btn_primary;
+  as.btn_secondary = btn_secondary;
+  as.wheel_hi_res = libevdev_has_event_code(evdev, EV_REL, REL_WHEEL_HI_RES);
+  as.verbose = 1;
+  // mouse_accel_set_speed(&as.accel, 0.9); // ?
+
+  if (use_uring) {
+    loop.on_event = loop_event;
+    if (threaded) {
+      loop.on_batch = loop_flush;
+      if (debounce_ms > 0) {
+        loop.on_tick = loop_debounce_tick;
+        loop.tick_interval_us = TICK_INTERVAL_US;
+      }
+    } else {
+      loop.on_tick = loop_tick;
+      loop.tick_interval_us = TICK_INTERVAL_US;
+    }
+    return uring_loop_run(&loop) < 0;
+  }
 
   // Event loop: read device events and run a callback at a regular interval
 
   struct input_event ev;
 
-  int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-  if (tfd == -1) {
-    perror("timerfd_create");
-    return 1;
-  }
+  int tfd = -1;
+  if (!threaded || debounce_ms > 0) {
+    tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (tfd == -1) {
+      perror("timerfd_create");
+      return 1;
+    }
 
-  struct itimerspec ts;
-  ts.it_interval.tv_sec = 0;
-  ts.it_interval.tv_nsec = TICK_INTERVAL_US * 1000;
-  ts.it_value = ts.it_interval; // first expiry
-  if (timerfd_settime(tfd, 0, &ts, NULL) == -1) {
-    perror("timerfd_settime");
-    return 1;
+    struct itimerspec ts;
+    ts.it_interval.tv_sec = 0;
+    ts.it_interval.tv_nsec = TICK_INTERVAL_US * 1000;
+    ts.it_value = ts.it_interval; // first expiry
+    if (timerfd_settime(tfd, 0, &ts, NULL) == -1) {
+      perror("timerfd_settime");
+      return 1;
+    }
   }
 
   struct pollfd fds[2];
   fds[0].fd = dev_fd;
   fds[0].events = POLLIN;
-  fds[1].fd = tfd;
+  fds[1].fd = tfd; // ignored by poll() when -1
   fds[1].events = POLLIN;
 
   while (1) {
@@ -547,15 +331,22 @@ int main(int argc, char *argv[]) {
     if (fds[0].revents & POLLIN) {
       while (libevdev_next_event(evdev, LIBEVDEV_READ_FLAG_NORMAL, &ev) ==
              LIBEVDEV_READ_STATUS_SUCCESS) {
-        handle_mouse_event(&ev);
+        autoscroll_handle_event(&as, &ev);
       }
+      if (threaded)
+        pipeline_flush(&pipeline);
     }
 
     // timer events
     if (fds[1].revents & POLLIN) {
       uint64_t expirations;
       read(tfd, &expirations, sizeof(expirations)); // must read to clear
-      tick();
+      uint64_t now = now_us();
+      autoscroll_tick(&as, now);
+      if (threaded)
+        pipeline_flush(&pipeline);
+      else
+        scroller_tick(&scroller, now);
     }
   }
 }
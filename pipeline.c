@@ -0,0 +1,131 @@
+#define _GNU_SOURCE
+
+#include "pipeline.h"
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static inline uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000ull;
+}
+
+int pipeline_init(struct pipeline *p, const struct autoscroll_params *params,
+                  const struct autoscroll_output *output) {
+  memset(p, 0, sizeof(*p));
+  scroller_init(&p->scroller, params, output);
+  p->wake_fd = eventfd(0, EFD_NONBLOCK);
+  if (p->wake_fd < 0) {
+    perror("eventfd");
+    return -1;
+  }
+  return 0;
+}
+
+void pipeline_flush(struct pipeline *p) {
+  // Pairs with the sleeping store / queue check in emitter_wait()
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load(&p->sleeping)) {
+    uint64_t one = 1;
+    write(p->wake_fd, &one, sizeof(one));
+  }
+}
+
+void pipeline_post(void *data, const struct scroll_cmd *cmd) {
+  struct pipeline *p = data;
+  uint32_t head = atomic_load_explicit(&p->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&p->tail, memory_order_acquire);
+
+  if (head - tail == PIPELINE_QUEUE_SIZE) {
+    p->stats.full_waits++;
+    pipeline_flush(p);
+    do {
+      sched_yield();
+      tail = atomic_load_explicit(&p->tail, memory_order_acquire);
+    } while (head - tail == PIPELINE_QUEUE_SIZE);
+  }
+  if (head - tail + 1 > p->stats.queue_max)
+    p->stats.queue_max = head - tail + 1;
+
+  p->cmds[head % PIPELINE_QUEUE_SIZE] = *cmd;
+  atomic_store_explicit(&p->head, head + 1, memory_order_release);
+}
+
+// Apply up to `max` queued commands, returns how many
+static int emitter_drain(struct pipeline *p, int max) {
+  uint32_t tail = atomic_load_explicit(&p->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&p->head, memory_order_acquire);
+  int n = 0;
+  for (; tail != head && n < max; tail++, n++)
+    scroller_apply(&p->scroller, &p->cmds[tail % PIPELINE_QUEUE_SIZE]);
+  atomic_store_explicit(&p->tail, tail, memory_order_release);
+  return n;
+}
+
+static void emitter_wait(struct pipeline *p, uint64_t until_us) {
+  atomic_store(&p->sleeping, 1);
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load(&p->head) == atomic_load(&p->tail)) {
+    uint64_t t = now_us();
+    uint64_t wait_us = until_us > t ? until_us - t : 0;
+    struct timespec timeout = {wait_us / 1000000, (wait_us % 1000000) * 1000};
+    struct pollfd pfd = {p->wake_fd, POLLIN, 0};
+    if (ppoll(&pfd, 1, &timeout, NULL) > 0) {
+      uint64_t count;
+      read(p->wake_fd, &count, sizeof(count));
+    }
+  }
+  atomic_store(&p->sleeping, 0);
+}
+
+static void *emitter_main(void *data) {
+  struct pipeline *p = data;
+  uint64_t next_frame = now_us() + TICK_INTERVAL_US;
+
+  while (!atomic_load(&p->stop)) {
+    // Frames first, then commands in batches so a burst cannot hold a
+    // frame back for long
+    uint64_t t = now_us();
+    if (t >= next_frame) {
+      uint64_t late = t - next_frame;
+      p->stats.ticks++;
+      p->stats.late_sum_us += late;
+      if (late > p->stats.late_max_us)
+        p->stats.late_max_us = late;
+
+      scroller_tick(&p->scroller, t);
+      next_frame += TICK_INTERVAL_US;
+      if (next_frame <= t) // missed whole frames, don't try to catch up
+        next_frame = t + TICK_INTERVAL_US;
+      continue;
+    }
+    if (emitter_drain(p, PIPELINE_BATCH) > 0)
+      continue;
+    emitter_wait(p, next_frame);
+  }
+  emitter_drain(p, PIPELINE_QUEUE_SIZE);
+  return NULL;
+}
+
+int pipeline_start(struct pipeline *p) {
+  int rc = pthread_create(&p->thread, NULL, emitter_main, p);
+  if (rc) {
+    fprintf(stderr, "Failed starting emitter thread: %s\n", strerror(rc));
+    return -1;
+  }
+  return 0;
+}
+
+void pipeline_stop(struct pipeline *p) {
+  atomic_store(&p->stop, 1);
+  uint64_t one = 1;
+  write(p->wake_fd, &one, sizeof(one));
+  pthread_join(p->thread, NULL);
+  close(p->wake_fd);
+}
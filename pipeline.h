@@ -0,0 +1,52 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+// Optional two-thread mode. The reader thread (the caller) runs the state
+// machine and posts its commands into a lock-free single-producer,
+// single-consumer queue. An emitter thread owns the scroller: it applies the
+// commands, does all device writes and blocking waits, and runs the frame
+// clock. A burst of input no longer delays frames by more than one batch of
+// commands, and a slow write never delays reading.
+
+#include "autoscroll.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define PIPELINE_QUEUE_SIZE 4096 // power of two
+#define PIPELINE_BATCH 64        // commands applied between clock checks
+
+struct pipeline_stats {
+  uint64_t ticks;
+  uint64_t late_sum_us; // how late ticks ran after their deadline
+  uint64_t late_max_us;
+  uint32_t queue_max;   // deepest the queue got
+  uint64_t full_waits;  // times the reader found the queue full
+};
+
+struct pipeline {
+  _Alignas(64) _Atomic uint32_t head; // next slot the reader writes
+  _Alignas(64) _Atomic uint32_t tail; // next slot the emitter reads
+  _Alignas(64) _Atomic int sleeping;  // emitter is waiting on wake_fd
+  _Atomic int stop;
+  int wake_fd;
+  pthread_t thread;
+  struct pipeline_stats stats;
+  struct scroller scroller;
+  struct scroll_cmd cmds[PIPELINE_QUEUE_SIZE];
+};
+
+// Set up the queue and scroller. The scroller may be adjusted before
+// pipeline_start().
+int pipeline_init(struct pipeline *p, const struct autoscroll_params *params,
+                  const struct autoscroll_output *output);
+int pipeline_start(struct pipeline *p);
+void pipeline_stop(struct pipeline *p);
+
+// Post callback for struct autoscroll, data is a struct pipeline. Reader
+// thread only.
+void pipeline_post(void *data, const struct scroll_cmd *cmd);
+
+// Wake the emitter if it is idle. Call after each batch of device events.
+void pipeline_flush(struct pipeline *p);
+
+#endif
@@ -25,6 +25,10 @@
     // If changing speed:
     mouse_accel_set_speed(&accel, speed_adjustment); // [-1.0, +1.0]
 
+    // If changing profile (the default is adaptive):
+    mouse_accel_set_profile_flat(&accel);
+    mouse_accel_set_profile_custom(&accel, step, points, npoints);
+
     // When done:
     mouse_accel_destroy(&accel);
 */
@@ -65,6 +69,25 @@ extern "C"
         int next;
     } mouse_accel_trackers_t;
 
+    typedef enum
+    {
+        MOUSE_ACCEL_PROFILE_FLAT,
+        MOUSE_ACCEL_PROFILE_ADAPTIVE,
+        MOUSE_ACCEL_PROFILE_CUSTOM,
+    } mouse_accel_profile_t;
+
+#define MOUSE_ACCEL_LUT_SIZE 1024
+
+    /* Acceleration factor sampled at evenly spaced velocities in
+     * [0, max_velocity], in units/us. Velocities past the end use the last
+     * sample. */
+    typedef struct
+    {
+        double factors[MOUSE_ACCEL_LUT_SIZE];
+        double max_velocity;
+        double inv_step;
+    } mouse_accel_lut_t;
+
     typedef struct
     {
         /* config */
@@ -72,6 +95,8 @@ extern "C"
         double accel;
         double incline;
         int dpi;
+        mouse_accel_profile_t profile;
+        mouse_accel_lut_t lut;
 
         /* state */
         double last_velocity;
@@ -88,14 +113,14 @@ extern "C"
 
     /* ====== Trackers ====== */
 
-    static void mouse_accel_trackers_init(mouse_accel_trackers_t *t, int points)
+    static inline void mouse_accel_trackers_init(mouse_accel_trackers_t *t, int points)
     {
         memset(t, 0, sizeof(*t));
         t->npoints = (points > MOUSE_ACCEL_TRACKERS_MAX) ? MOUSE_ACCEL_TRACKERS_MAX : points;
         t->next = 0;
     }
 
-    static void mouse_accel_trackers_feed(mouse_accel_trackers_t *t, double dx, double dy, uint64_t time)
+    static inline void mouse_accel_trackers_feed(mouse_accel_trackers_t *t, double dx, double dy, uint64_t time)
     {
         t->points[t->next].delta.x = dx;
         t->points[t->next].delta.y = dy;
@@ -103,7 +128,7 @@ extern "C"
         t->next = (t->next + 1) % t->npoints;
     }
 
-    static void mouse_accel_trackers_reset(mouse_accel_trackers_t *t, uint64_t time)
+    static inline void mouse_accel_trackers_reset(mouse_accel_trackers_t *t, uint64_t time)
     {
         for (int i = 0; i < t->npoints; ++i)
         {
@@ -115,7 +140,7 @@ extern "C"
     }
 
     /* Calculate velocity in units/us */
-    static double mouse_accel_trackers_velocity(mouse_accel_trackers_t *t, uint64_t now)
+    static inline double mouse_accel_trackers_velocity(mouse_accel_trackers_t *t, uint64_t now)
     {
         double dx = 0, dy = 0;
         uint64_t oldest = now, newest = 0;
@@ -139,6 +164,98 @@ extern "C"
         return dist / (double)dt;
     }
 
+    /* Velocity over the newest n points only, in units/us. The oldest of those
+     * points only marks the start of the interval, as do any points sharing
+     * its timestamp (e.g. REL_X and REL_Y from the same frame). */
+    static inline double mouse_accel_trackers_velocity_recent(mouse_accel_trackers_t *t, int n)
+    {
+        double dx = 0, dy = 0;
+        if (n > t->npoints)
+            n = t->npoints;
+        int newest_i = (t->next + t->npoints - 1) % t->npoints;
+        int oldest_i = (t->next + t->npoints - n) % t->npoints;
+        uint64_t newest = t->points[newest_i].time;
+        uint64_t oldest = t->points[oldest_i].time;
+
+        for (int k = 1; k <= n; ++k)
+        {
+            mouse_accel_tracker_t *p = &t->points[(t->next + t->npoints - k) % t->npoints];
+            if (p->time <= oldest)
+                continue;
+            dx += p->delta.x;
+            dy += p->delta.y;
+        }
+        if (newest <= oldest)
+            return 0;
+        return sqrt(dx * dx + dy * dy) / (double)(newest - oldest);
+    }
+
+    /* ====== Velocity Prediction ====== */
+
+    /* Alpha-beta filter over tracker velocity, used to guess the velocity a
+     * little ahead of the last event. Velocity is in units/us, acceleration
+     * in units/us^2. */
+    typedef struct
+    {
+        double alpha;
+        double beta;
+        double velocity;
+        double acceleration;
+        double measured; /* last raw sample */
+        double interval; /* smoothed time between samples, us */
+        uint64_t time;
+    } mouse_accel_predictor_t;
+
+/* No samples for this long means the device stopped moving */
+#define MOUSE_ACCEL_PREDICTOR_IDLE_US 20000
+
+    static inline void mouse_accel_predictor_init(mouse_accel_predictor_t *p, double alpha, double beta)
+    {
+        memset(p, 0, sizeof(*p));
+        p->alpha = alpha;
+        p->beta = beta;
+    }
+
+    static inline void mouse_accel_predictor_reset(mouse_accel_predictor_t *p)
+    {
+        mouse_accel_predictor_init(p, p->alpha, p->beta);
+    }
+
+    static inline void mouse_accel_predictor_feed(mouse_accel_predictor_t *p, double velocity, uint64_t time)
+    {
+        p->measured = velocity;
+        if (p->time == 0 || time < p->time || time - p->time > MOUSE_ACCEL_PREDICTOR_IDLE_US)
+        {
+            p->velocity = velocity;
+            p->acceleration = 0;
+            p->time = time;
+            return;
+        }
+
+        double dt = (double)(time - p->time);
+        double predicted = p->velocity + p->acceleration * dt;
+        double residual = velocity - predicted;
+        p->velocity = predicted + p->alpha * residual;
+        if (dt > 0)
+        {
+            p->acceleration += p->beta * residual / dt;
+            p->interval = p->interval > 0 ? p->interval + 0.1 * (dt - p->interval) : dt;
+        }
+        p->time = time;
+    }
+
+    /* Predicted velocity at `time`, extrapolating at most `horizon` us past
+     * the last sample. The result never goes past the last raw sample, so a
+     * step input cannot overshoot. */
+    static inline double mouse_accel_predictor_predict(const mouse_accel_predictor_t *p, uint64_t time, uint64_t horizon)
+    {
+        if (p->time == 0 || time > p->time + MOUSE_ACCEL_PREDICTOR_IDLE_US)
+            return 0;
+        double dt = time > p->time ? (double)(time - p->time) : 0;
+        double v = p->velocity + p->acceleration * double_min(dt, (double)horizon);
+        return double_max(0, double_min(v, double_max(p->velocity, p->measured)));
+    }
+
     /* ====== Acceleration Profile ====== */
 
 #define MOUSE_ACCEL_DEFAULT_THRESHOLD v_ms2us(0.4)
@@ -146,7 +263,7 @@ extern "C"
 #define MOUSE_ACCEL_DEFAULT_ACCELERATION 2.0
 #define MOUSE_ACCEL_DEFAULT_INCLINE 1.1
 
-    static double mouse_accel_profile_linear(mouse_accel_t *accel, double speed_in)
+    static inline double mouse_accel_profile_linear(mouse_accel_t *accel, double speed_in)
     {
         double max_accel = accel->accel;
         double threshold = accel->threshold;
@@ -173,12 +290,110 @@ extern "C"
         return factor;
     }
 
+    /* ====== Lookup Tables ====== */
+
+    /* Compile any profile into a dense table over velocity. This is the only
+     * place profiles are evaluated analytically; the input path only does
+     * mouse_accel_lut_lookup(). */
+    static inline void mouse_accel_lut_build(mouse_accel_lut_t *lut, double max_velocity,
+                                      double (*profile)(void *data, double speed_in), void *data)
+    {
+        lut->max_velocity = max_velocity;
+        lut->inv_step = (MOUSE_ACCEL_LUT_SIZE - 1) / max_velocity;
+        for (int i = 0; i < MOUSE_ACCEL_LUT_SIZE; ++i)
+            lut->factors[i] = profile(data, i / lut->inv_step);
+    }
+
+    static inline double mouse_accel_lut_lookup(const mouse_accel_lut_t *lut, double speed_in)
+    {
+        double x = speed_in * lut->inv_step;
+        if (!(x > 0))
+            return lut->factors[0];
+        if (x >= MOUSE_ACCEL_LUT_SIZE - 1)
+            return lut->factors[MOUSE_ACCEL_LUT_SIZE - 1];
+        int i = (int)x;
+        double t = x - i;
+        return lut->factors[i] + t * (lut->factors[i + 1] - lut->factors[i]);
+    }
+
+    static inline double mouse_accel_lut_flat_profile(void *data, double speed_in)
+    {
+        return *(const double *)data;
+    }
+
+    /* Flat: a constant factor of 1 + speed_adjustment, like libinput */
+    static inline void mouse_accel_lut_build_flat(mouse_accel_lut_t *lut, double speed_adjustment)
+    {
+        double factor = 1.0 + speed_adjustment;
+        mouse_accel_lut_build(lut, v_ms2us(1.0), mouse_accel_lut_flat_profile, &factor);
+    }
+
+    static inline double mouse_accel_lut_adaptive_profile(void *data, double speed_in)
+    {
+        return mouse_accel_profile_linear((mouse_accel_t *)data, speed_in);
+    }
+
+    /* Adaptive: mouse_accel_profile_linear() up to a bit past the velocity
+     * where it reaches max_accel, after which it is constant */
+    static inline void mouse_accel_lut_build_adaptive(mouse_accel_lut_t *lut, mouse_accel_t *accel)
+    {
+        double dpi_factor = accel->dpi / (double)1000;
+        double max_accel = accel->accel / dpi_factor;
+        double threshold = accel->threshold * dpi_factor;
+        double max_velocity = threshold + v_ms2us(double_max(0, max_accel - 1) / accel->incline);
+        max_velocity = double_max(max_velocity, v_ms2us(0.07)) * 1.25;
+        mouse_accel_lut_build(lut, max_velocity, mouse_accel_lut_adaptive_profile, accel);
+    }
+
+    typedef struct
+    {
+        double step;
+        const double *points;
+        int npoints;
+    } mouse_accel_custom_curve_t;
+
+    static inline double mouse_accel_lut_custom_profile(void *data, double speed_in)
+    {
+        const mouse_accel_custom_curve_t *curve = data;
+        speed_in = double_min(speed_in, v_ms2us(curve->step * (curve->npoints - 1)));
+        double x = v_us2ms(speed_in) / curve->step;
+        int i = (int)x;
+        if (i >= curve->npoints - 1)
+            i = curve->npoints - 2;
+        double speed_out = curve->points[i] + (x - i) * (curve->points[i + 1] - curve->points[i]);
+
+        /* The curve maps input speed to output speed, the table stores the
+         * ratio. At zero use the slope of the first segment. */
+        if (x <= 0)
+            return (curve->points[1] - curve->points[0]) / curve->step;
+        return speed_out / v_us2ms(speed_in);
+    }
+
+    /* Custom: libinput-style point list. points[i] is the output speed for an
+     * input speed of i * step, both in units/ms. Speeds past the last point
+     * keep the last point's factor. */
+    static inline int mouse_accel_lut_build_custom(mouse_accel_lut_t *lut, double step,
+                                            const double *points, int npoints)
+    {
+        if (step <= 0 || npoints < 2)
+            return -1;
+        mouse_accel_custom_curve_t curve = {step, points, npoints};
+        mouse_accel_lut_build(lut, v_ms2us(step * (npoints - 1)), mouse_accel_lut_custom_profile, &curve);
+        return 0;
+    }
+
+    /* Acceleration factor for the current profile */
+    static inline double mouse_accel_profile(const mouse_accel_t *accel, double speed_in)
+    {
+        return mouse_accel_lut_lookup(&accel->lut, speed_in);
+    }
+
     /* ====== Main API ====== */
 
     /* Initialize mouse_accel struct.
      * dpi: physical device DPI (dots per inch)
      */
-    static void mouse_accel_init(mouse_accel_t *accel, int dpi)
+    static inline void mouse_accel_init(mouse_accel_t *accel, int dpi)
     {
         memset(accel, 0, sizeof(*accel));
         accel->threshold = MOUSE_ACCEL_DEFAULT_THRESHOLD;
@@ -190,14 +405,16 @@ extern "C"
         mouse_accel_trackers_init(&accel->trackers, 16);
         accel->last_velocity = 0.0;
         accel->speed_adjustment = 0.0;
+        accel->profile = MOUSE_ACCEL_PROFILE_ADAPTIVE;
+        mouse_accel_lut_build_adaptive(&accel->lut, accel);
     }
 
-    static void mouse_accel_destroy(mouse_accel_t *accel)
+    static inline void mouse_accel_destroy(mouse_accel_t *accel)
     {
         /* nothing to do */
     }
 
-    static void mouse_accel_set_speed(mouse_accel_t *accel, double speed_adjustment)
+    static inline void mouse_accel_set_speed(mouse_accel_t *accel, double speed_adjustment)
     {
         if (speed_adjustment < -1.0)
             speed_adjustment = -1.0;
@@ -211,10 +428,39 @@ extern "C"
         accel->accel = MOUSE_ACCEL_DEFAULT_ACCELERATION + speed_adjustment * 1.5;
         accel->incline = MOUSE_ACCEL_DEFAULT_INCLINE + speed_adjustment * 0.75;
         accel->speed_adjustment = speed_adjustment;
+
+        /* Custom curves already encode the speed */
+        if (accel->profile == MOUSE_ACCEL_PROFILE_ADAPTIVE)
+            mouse_accel_lut_build_adaptive(&accel->lut, accel);
+        else if (accel->profile == MOUSE_ACCEL_PROFILE_FLAT)
+            mouse_accel_lut_build_flat(&accel->lut, accel->speed_adjustment);
+    }
+
+    static inline void mouse_accel_set_profile_flat(mouse_accel_t *accel)
+    {
+        accel->profile = MOUSE_ACCEL_PROFILE_FLAT;
+        mouse_accel_lut_build_flat(&accel->lut, accel->speed_adjustment);
+    }
+
+    static inline void mouse_accel_set_profile_adaptive(mouse_accel_t *accel)
+    {
+        accel->profile = MOUSE_ACCEL_PROFILE_ADAPTIVE;
+        mouse_accel_lut_build_adaptive(&accel->lut, accel);
+    }
+
+    /* See mouse_accel_lut_build_custom(). Returns -1 if the curve is invalid,
+     * in which case the current profile is kept. */
+    static inline int mouse_accel_set_profile_custom(mouse_accel_t *accel, double step,
+                                              const double *points, int npoints)
+    {
+        if (mouse_accel_lut_build_custom(&accel->lut, step, points, npoints) < 0)
+            return -1;
+        accel->profile = MOUSE_ACCEL_PROFILE_CUSTOM;
+        return 0;
     }
 
     /* Feed a new unaccelerated delta sample to the filter */
-    static void mouse_accel_feed(mouse_accel_t *accel, double dx, double dy, uint64_t time_us)
+    static inline void mouse_accel_feed(mouse_accel_t *accel, double dx, double dy, uint64_t time_us)
     {
         /* Normalize for DPI: units are in 1000dpi */
         double norm_dx = dx * (1000.0 / accel->dpi);
@@ -227,7 +473,7 @@ extern "C"
      * timestamp_us: timestamp in microseconds
      * out_dx, out_dy: outputs (normalized units)
      */
-    static void mouse_accel_get_accelerated(mouse_accel_t *accel, double dx, double dy, uint64_t timestamp_us,
+    static inline void mouse_accel_get_accelerated(mouse_accel_t *accel, double dx, double dy, uint64_t timestamp_us,
                                             double *out_dx, double *out_dy)
     {
         /* Normalize for DPI: units are in 1000dpi */
@@ -244,7 +490,7 @@ extern "C"
         //        dx, dy, timestamp_us, velocity);
 
         /* Calculate acceleration factor */
-        double accel_factor = mouse_accel_profile_linear(accel, velocity);
+        double accel_factor = mouse_accel_profile(accel, velocity);
 
         /* Output accelerated deltas */
         *out_dx = norm_dx * accel_factor;
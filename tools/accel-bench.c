@@ -0,0 +1,99 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Compares the lookup table acceleration profiles against the analytic
+// versions they are compiled from, then times both.
+//
+//   make tools/accel-bench && tools/accel-bench
+
+#include "../pointer_accel.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define SAMPLES 100000
+#define BENCH_CALLS 20000000
+#define MAX_ABS_ERROR 0.02
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static double velocities[4096];
+
+static void fill_velocities(double max_velocity) {
+  uint32_t x = 2463534242u;
+  for (int i = 0; i < 4096; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    velocities[i] = max_velocity * (x / (double)UINT32_MAX);
+  }
+}
+
+// Worst error of the table over [0, 2 * max_velocity]
+static double lut_error(mouse_accel_t *accel,
+                        double (*profile)(void *data, double speed_in),
+                        void *data) {
+  double worst = 0;
+  for (int i = 0; i <= SAMPLES; i++) {
+    double v = 2 * accel->lut.max_velocity * i / SAMPLES;
+    double err = fabs(mouse_accel_profile(accel, v) - profile(data, v));
+    worst = double_max(worst, err);
+  }
+  return worst;
+}
+
+static double bench(mouse_accel_t *accel, int use_lut) {
+  volatile double sink = 0;
+  double sum = 0;
+  uint64_t start = now_ns();
+  for (int i = 0; i < BENCH_CALLS; i++) {
+    double v = velocities[i & 4095];
+    sum += use_lut ? mouse_accel_profile(accel, v)
+                   : mouse_accel_profile_linear(accel, v);
+  }
+  sink = sum;
+  (void)sink;
+  return (double)(now_ns() - start) / BENCH_CALLS;
+}
+
+int main(void) {
+  static const int dpis[] = {400, 800, 1000, 1600, 3200};
+  static const double speeds[] = {-1.0, -0.5, 0.0, 0.5, 1.0};
+  static mouse_accel_t accel;
+  int failed = 0;
+
+  printf("adaptive profile, max abs error over %d samples:\n", SAMPLES);
+  for (unsigned d = 0; d < sizeof(dpis) / sizeof(*dpis); d++) {
+    for (unsigned s = 0; s < sizeof(speeds) / sizeof(*speeds); s++) {
+      mouse_accel_init(&accel, dpis[d]);
+      mouse_accel_set_speed(&accel, speeds[s]);
+      double err = lut_error(&accel, mouse_accel_lut_adaptive_profile, &accel);
+      printf("  dpi %4d speed %+.1f: %.6f\n", dpis[d], speeds[s], err);
+      failed |= err > MAX_ABS_ERROR;
+    }
+  }
+
+  // Roughly libinput's "custom" example: slow start, then a steep ramp
+  static const double points[] = {0.0, 0.3, 0.8, 1.5, 2.6, 4.0, 5.6, 7.4};
+  mouse_accel_custom_curve_t curve = {0.25, points, 8};
+  mouse_accel_init(&accel, 1000);
+  mouse_accel_set_profile_custom(&accel, curve.step, curve.points,
+                                 curve.npoints);
+  double err = lut_error(&accel, mouse_accel_lut_custom_profile, &curve);
+  printf("custom profile, max abs error: %.6f\n", err);
+  failed |= err > MAX_ABS_ERROR;
+
+  mouse_accel_init(&accel, 1000);
+  fill_velocities(2 * accel.lut.max_velocity);
+  double ns_linear = bench(&accel, 0);
+  double ns_lut = bench(&accel, 1);
+  printf("mouse_accel_profile_linear: %.2f ns/call\n", ns_linear);
+  printf("mouse_accel_profile (lut):  %.2f ns/call\n", ns_lut);
+
+  if (failed)
+    fprintf(stderr, "Lookup table error above %.3f\n", MAX_ABS_ERROR);
+  return failed;
+}
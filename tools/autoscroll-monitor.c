@@ -0,0 +1,163 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Shows the daemon's live state (see monitor.h) top-style, refreshed every
+// interval. Reading costs no syscalls, the daemon is never held up.
+//
+//   tools/autoscroll-monitor [-i interval_ms] [-n count]
+
+#include "../monitor.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STALE_US 500000
+
+static inline uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000ull;
+}
+
+static const char *state_name(int state) {
+  switch (state) {
+  case STATE_WAITING_FOR_SECONDARY_PRESS:
+    return "WAITING_FOR_SECONDARY_PRESS";
+  case STATE_SCROLLING_WAITING:
+    return "SCROLLING_WAITING";
+  case STATE_SCROLLING:
+    return "SCROLLING";
+  case STATE_SCROLLING_DISCRETE:
+    return "SCROLLING_DISCRETE";
+  case STATE_ACTION_WAITING:
+    return "ACTION_WAITING";
+  case STATE_KANDO:
+    return "KANDO";
+  case STATE_KANDO_MOVED:
+    return "KANDO_MOVED";
+  case STATE_BACK:
+    return "BACK";
+  }
+  return "?";
+}
+
+const struct monitor_shm *shm;
+ino_t shm_ino;
+
+static int map_shm(void) {
+  int fd = open(MONITOR_PATH, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(*shm)) {
+    close(fd);
+    return -1;
+  }
+  const struct monitor_shm *m =
+      mmap(NULL, sizeof(*m), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (m == MAP_FAILED)
+    return -1;
+  atomic_thread_fence(memory_order_acquire);
+  if (m->magic != MONITOR_MAGIC || m->version < MONITOR_VERSION ||
+      m->size < sizeof(*m)) {
+    munmap((void *)m, sizeof(*m));
+    return -1;
+  }
+  if (shm)
+    munmap((void *)shm, sizeof(*shm));
+  shm = m;
+  shm_ino = st.st_ino;
+  return 0;
+}
+
+// Reopen if the daemon has replaced the file
+static void remap_shm(void) {
+  struct stat st;
+  if (stat(MONITOR_PATH, &st) == 0 && st.st_ino != shm_ino)
+    map_shm();
+}
+
+static uint32_t read_state(struct monitor_state *s) {
+  uint32_t seq;
+  do {
+    seq = atomic_load_explicit(&shm->seq, memory_order_acquire);
+    memcpy(s, &shm->state, sizeof(*s));
+    atomic_thread_fence(memory_order_acquire);
+  } while ((seq & 1) ||
+           seq != atomic_load_explicit(&shm->seq, memory_order_relaxed));
+  return seq;
+}
+
+int main(int argc, char *argv[]) {
+  int interval_ms = 100;
+  long count = -1;
+  int opt;
+  while ((opt = getopt(argc, argv, "i:n:")) != -1) {
+    switch (opt) {
+    case 'i':
+      interval_ms = atoi(optarg);
+      break;
+    case 'n':
+      count = atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-i interval_ms] [-n count]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (interval_ms < 1) {
+    fprintf(stderr, "Interval must be positive\n");
+    return 1;
+  }
+  if (map_shm() < 0) {
+    fprintf(stderr, "%s: not found, is mouse-autoscroll running?\n",
+            MONITOR_PATH);
+    return 1;
+  }
+
+  int tty = isatty(STDOUT_FILENO);
+  struct monitor_state s, prev;
+  uint32_t seq = read_state(&prev), prev_seq = seq;
+  uint64_t prev_t = now_us(), changed_t = prev_t;
+
+  for (long n = 0; count < 0 || n < count; n++) {
+    struct timespec ts = {interval_ms / 1000, (interval_ms % 1000) * 1000000};
+    nanosleep(&ts, NULL);
+    uint64_t t = now_us();
+    seq = read_state(&s);
+    if (seq != prev_seq)
+      changed_t = t;
+    int stale = t - changed_t > STALE_US;
+    if (stale)
+      remap_shm();
+    double ticks_per_s = 0;
+    if (s.ticks >= prev.ticks) // not across a daemon restart
+      ticks_per_s = (s.ticks - prev.ticks) * 1e6 / (t - prev_t);
+
+    if (tty)
+      printf("\033[H\033[J");
+    printf("mouse-autoscroll pid %u, %.0f ticks/s%s\n", shm->pid, ticks_per_s,
+           stale ? " (not updating)" : "");
+    printf("state      %s\n", state_name(s.state));
+    printf("direction  x %+d  y %+d\n", s.dir_x, s.dir_y);
+    printf("velocity   x %7.3f  y %7.3f  (target %7.3f, %7.3f) hi-res/ms\n",
+           s.vel_x, s.vel_y, s.target_vel_x, s.target_vel_y);
+    printf("boost      %7.3f  accel %.3f\n", s.vel_boost, s.accel_factor);
+    printf("tick       %.2f ms, max %.2f ms\n", s.tick_delta_us / 1000.0,
+           s.tick_delta_max_us / 1000.0);
+    if (!tty)
+      printf("\n");
+    fflush(stdout);
+
+    prev = s;
+    prev_seq = seq;
+    prev_t = t;
+  }
+  return 0;
+}
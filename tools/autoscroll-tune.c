@@ -0,0 +1,660 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Offline parameter sweep: replays recorded evdev traces through the event
+// handling core for every parameter set in a search space, on all cores,
+// and ranks the sets by smoothness, lag and overshoot. Every set also gets
+// the rise time of its step response, from synthetic motion, which is shown
+// but not scored.
+//
+// Record a trace (raw struct input_event, as read from the device):
+//
+//   sudo cat /dev/input/by-id/...-event-mouse > scroll.trace
+//
+// Sweep a grid, or draw random samples from the same ranges with -n:
+//
+//   tools/autoscroll-tune -p vel_update_rate=0.01:0.1:10
+//       -p boost_decay=0.005:0.02:4 scroll.trace
+//   tools/autoscroll-tune -n 20000 -p base_vel=0.5:3 -p boost_vel=0.02:0.3
+//       -p accel_incline=0.5:2 scroll.trace
+//
+// Scores are relative to the default parameters, which score 3.0.
+//
+// Smooth wheel against plain wheel events, from a trace of wheel scrolling:
+//
+//   tools/autoscroll-tune -p smooth_wheel=0:1:2
+//       -p wheel_duration_us=100000:300000:5 wheel.trace
+
+#include "../autoscroll.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_RANGES 16
+#define MAX_TRACES 64
+#define MAX_WORKERS 256
+#define LAG_MAX_TICKS 32
+#define LAG_LEAD_TICKS 4 // delays below zero, velocity ahead of its target
+#define LAG_RING (LAG_LEAD_TICKS + LAG_MAX_TICKS)
+#define TAIL_US (1000 * 1000)
+#define STEP_COUNTS 3                 // per event, at 1 kHz
+#define STEP_US (2000 * 1000)         // of steady motion
+#define STEP_FINAL_US (250 * 1000)    // averaged for the final velocity
+#define STEP_TICKS (STEP_US / TICK_INTERVAL_US + 1)
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Tunable parameters
+
+struct param {
+  const char *name;
+  size_t offset;
+  int is_int;
+  double scale; // command line value * scale = stored value
+};
+
+#define PARAM_D(field, scale)                                                  \
+  { #field, offsetof(struct autoscroll_params, field), 0, scale }
+#define PARAM_I(field)                                                         \
+  { #field, offsetof(struct autoscroll_params, field), 1, 1 }
+
+static const struct param params_table[] = {
+    PARAM_I(deadzone),
+    PARAM_D(base_vel, 1),
+    PARAM_D(boost_vel, 1),
+    PARAM_D(boost_decay, 1),
+    PARAM_D(boost_loss, 1),
+    PARAM_D(vel_update_rate, 1),
+    PARAM_D(vel_ramp_us, 1),
+    PARAM_D(accel_threshold, 0.001), // units/ms
+    PARAM_D(accel_max, 1),
+    PARAM_D(accel_incline, 1),
+    PARAM_I(predictive),
+    PARAM_D(predict_alpha, 1),
+    PARAM_D(predict_beta, 1),
+    PARAM_I(predict_points),
+    PARAM_D(predict_vel_update_rate, 1),
+    PARAM_I(smooth_wheel),
+    PARAM_D(wheel_duration_us, 1),
+    PARAM_D(wheel_accel, 1),
+    PARAM_D(wheel_accel_max, 1),
+    PARAM_D(debounce_us, 1),
+};
+#define PARAMS_COUNT (sizeof(params_table) / sizeof(*params_table))
+
+static void param_set(struct autoscroll_params *p, const struct param *param,
+                      double value) {
+  char *field = (char *)p + param->offset;
+  if (param->is_int)
+    *(int *)field = (int)lround(value);
+  else
+    *(double *)field = value * param->scale;
+}
+
+// Search space
+
+struct range {
+  const struct param *param;
+  double lo, hi;
+  int steps;
+};
+
+struct range ranges[MAX_RANGES];
+int nranges = 0;
+uint64_t random_samples = 0; // 0: grid
+uint64_t seed = 1;
+
+static uint64_t splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+static uint64_t jobs_count(void) {
+  if (random_samples)
+    return random_samples;
+  uint64_t n = 1;
+  for (int i = 0; i < nranges; i++)
+    n *= ranges[i].steps;
+  return n;
+}
+
+// Parameter set for a job, computed from its index so jobs need no storage
+static void job_params(uint64_t job, struct autoscroll_params *p) {
+  *p = (struct autoscroll_params)AUTOSCROLL_DEFAULT_PARAMS;
+  for (int i = 0; i < nranges; i++) {
+    struct range *r = &ranges[i];
+    double u;
+    if (random_samples) {
+      u = (splitmix64(seed ^ splitmix64(job * MAX_RANGES + i)) >> 11) *
+          (1.0 / 9007199254740992.0);
+    } else {
+      int step = job % r->steps;
+      job /= r->steps;
+      u = r->steps > 1 ? (double)step / (r->steps - 1) : 0;
+    }
+    param_set(p, r->param, r->lo + u * (r->hi - r->lo));
+  }
+}
+
+static int parse_range(const char *arg) {
+  const char *eq = strchr(arg, '=');
+  if (!eq || nranges == MAX_RANGES)
+    return -1;
+  struct range *r = &ranges[nranges];
+  r->param = NULL;
+  for (unsigned i = 0; i < PARAMS_COUNT; i++) {
+    if (strlen(params_table[i].name) == (size_t)(eq - arg) &&
+        strncmp(params_table[i].name, arg, eq - arg) == 0)
+      r->param = &params_table[i];
+  }
+  if (!r->param) {
+    fprintf(stderr, "Unknown parameter: %.*s\n", (int)(eq - arg), arg);
+    return -1;
+  }
+  r->steps = 1;
+  int n = sscanf(eq + 1, "%lf:%lf:%d", &r->lo, &r->hi, &r->steps);
+  if (n == 1)
+    r->hi = r->lo;
+  if (n < 1 || r->steps < 1)
+    return -1;
+  nranges++;
+  return 0;
+}
+
+// Traces
+
+struct trace {
+  const char *path;
+  struct input_event *events;
+  size_t count;
+  int wheel_hi_res;
+};
+
+struct trace traces[MAX_TRACES];
+int ntraces = 0;
+uint64_t total_events = 0;
+
+static int load_trace(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (size <= 0 || size % sizeof(struct input_event) != 0) {
+    fprintf(stderr, "%s: not a trace of struct input_event\n", path);
+    fclose(f);
+    return -1;
+  }
+  struct trace *t = &traces[ntraces++];
+  t->path = path;
+  t->count = size / sizeof(struct input_event);
+  t->events = malloc(size);
+  if (!t->events || fread(t->events, 1, size, f) != (size_t)size) {
+    fprintf(stderr, "%s: read failed\n", path);
+    fclose(f);
+    return -1;
+  }
+  fclose(f);
+  for (size_t i = 0; i < t->count; i++)
+    if (t->events[i].type == EV_REL && t->events[i].code == REL_WHEEL_HI_RES)
+      t->wheel_hi_res = 1;
+  total_events += t->count;
+  return 0;
+}
+
+// Simulation
+
+struct metrics {
+  double smoothness; // RMS change of scroll output between frames, hi-res
+  double lag_ms;     // delay that best aligns velocity with its target, < 0
+                     // if velocity runs ahead
+  double overshoot;  // hi-res scrolled after release, per gesture
+  double rise_ms;    // step response: scroll velocity reaches 90% of final
+  double score;
+};
+
+struct sim {
+  struct autoscroll as;
+  struct scroller sc;
+  int frame_x, frame_y; // hi-res emitted during the current tick
+  int wheel_frame;      // wheel moved during the current tick
+  int prev_x, prev_y;
+  double jerk_sum;
+  uint64_t frames;
+
+  // Squared error between velocity and the target d ticks earlier, for d
+  // from -LAG_LEAD_TICKS on. Velocity is compared LAG_LEAD_TICKS late so that
+  // the targets after it are known.
+  double targets_x[LAG_RING], targets_y[LAG_RING];
+  double vel_x[LAG_RING], vel_y[LAG_RING];
+  char active[LAG_RING];
+  double lag_err[LAG_RING];
+  uint64_t ticks;
+
+  int releases;
+  double after_release;
+};
+
+static void sim_write(void *data, int device, unsigned int type,
+                      unsigned int code, int value) {
+  struct sim *sim = data;
+  if (device == OUTPUT_MOUSE && type == EV_REL) {
+    if (code == REL_WHEEL_HI_RES)
+      sim->frame_y += value;
+    else if (code == REL_HWHEEL_HI_RES)
+      sim->frame_x += value;
+  }
+}
+
+static void sim_sleep(void *data, uint64_t us) {}
+
+// Without smooth wheel, count wheel events as if passed through, as the
+// desktop would see them without the daemon
+static void sim_wheel(struct sim *sim, const struct input_event *ev,
+                      int hi_res) {
+  if (ev->type != EV_REL)
+    return;
+  if (hi_res && ev->code == REL_WHEEL_HI_RES)
+    sim->frame_y += ev->value;
+  else if (hi_res && ev->code == REL_HWHEEL_HI_RES)
+    sim->frame_x += ev->value;
+  else if (!hi_res && ev->code == REL_WHEEL)
+    sim->frame_y += 120 * ev->value;
+  else if (!hi_res && ev->code == REL_HWHEEL)
+    sim->frame_x += 120 * ev->value;
+  else
+    return;
+  sim->wheel_frame = 1;
+}
+
+static void sim_tick(struct sim *sim, uint64_t t) {
+  struct autoscroll *as = &sim->as;
+  struct scroller *sc = &sim->sc;
+  int wheel = sim->wheel_frame || sc->wheel_x.distance != 0 ||
+              sc->wheel_y.distance != 0;
+  autoscroll_tick(as, t);
+  scroller_tick(sc, t);
+
+  int scrolling = as->state == STATE_SCROLLING;
+  if (scrolling || sim->frame_x || sim->frame_y || sim->prev_x ||
+      sim->prev_y) {
+    double jx = sim->frame_x - sim->prev_x, jy = sim->frame_y - sim->prev_y;
+    sim->jerk_sum += jx * jx + jy * jy;
+    sim->frames++;
+  }
+  if (!scrolling && !as->secondary_pressed && !wheel)
+    sim->after_release += abs(sim->frame_x) + abs(sim->frame_y);
+  sim->prev_x = sim->frame_x;
+  sim->prev_y = sim->frame_y;
+  sim->frame_x = sim->frame_y = 0;
+  sim->wheel_frame = 0;
+
+  int i = sim->ticks % LAG_RING;
+  sim->targets_x[i] = sc->target_vel_x;
+  sim->targets_y[i] = sc->target_vel_y;
+  sim->vel_x[i] = sc->vel_x;
+  sim->vel_y[i] = sc->vel_y;
+  sim->active[i] = scrolling || sc->vel_x || sc->vel_y;
+  sim->ticks++;
+  int k = (i - LAG_LEAD_TICKS + LAG_RING) % LAG_RING;
+  if (sim->ticks >= LAG_RING && sim->active[k]) {
+    for (int d = -LAG_LEAD_TICKS; d < LAG_MAX_TICKS; d++) {
+      int j = (k - d + LAG_RING) % LAG_RING;
+      double ex = sim->vel_x[k] - sim->targets_x[j];
+      double ey = sim->vel_y[k] - sim->targets_y[j];
+      sim->lag_err[d + LAG_LEAD_TICKS] += ex * ex + ey * ey;
+    }
+  }
+}
+
+// Rise time after a step input: hold the secondary button still, then move
+// it STEP_COUNTS down every ms. Time from the first move until the scroll
+// velocity first reaches 90% of its final value.
+static void step_noop_write(void *data, int device, unsigned int type,
+                            unsigned int code, int value) {}
+
+static void step_input(struct autoscroll *as, uint64_t t, int type, int code,
+                       int value) {
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.time.tv_sec = t / 1000000;
+  ev.time.tv_usec = t % 1000000;
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  autoscroll_handle_event(as, &ev);
+}
+
+static double step_rise_ms(const struct autoscroll_params *params) {
+  struct autoscroll as;
+  struct scroller sc;
+  struct autoscroll_output output = {step_noop_write, sim_sleep, NULL};
+  scroller_init(&sc, params, &output);
+  autoscroll_init(&as, params, scroller_post, &sc);
+
+  uint64_t start = 1000ull * 1000000, next_tick = start - 100000;
+  step_input(&as, next_tick, EV_KEY, BTN_RIGHT, 1);
+  step_input(&as, next_tick, EV_SYN, SYN_REPORT, 0);
+  for (; next_tick < start; next_tick += TICK_INTERVAL_US)
+    scroller_tick(&sc, next_tick);
+
+  double vel[STEP_TICKS];
+  uint64_t at[STEP_TICKS];
+  int n = 0;
+  for (uint64_t t = start; t < start + STEP_US; t += 1000) {
+    for (; next_tick <= t; next_tick += TICK_INTERVAL_US) {
+      scroller_tick(&sc, next_tick);
+      at[n] = next_tick;
+      vel[n++] = fabs(sc.vel_y);
+    }
+    step_input(&as, t, EV_REL, REL_Y, STEP_COUNTS);
+    step_input(&as, t, EV_SYN, SYN_REPORT, 0);
+  }
+
+  int nfinal = STEP_FINAL_US / TICK_INTERVAL_US;
+  double final = 0;
+  for (int i = n - nfinal; i < n; i++)
+    final += vel[i] / nfinal;
+  for (int i = 0; i < n; i++) {
+    if (vel[i] >= 0.9 * final)
+      return (at[i] - start) / 1000.0;
+  }
+  return STEP_US / 1000.0;
+}
+
+static void simulate(const struct autoscroll_params *params,
+                     struct metrics *m) {
+  struct sim sim;
+  memset(&sim, 0, sizeof(sim));
+  struct autoscroll_output output = {sim_write, sim_sleep, &sim};
+
+  for (int k = 0; k < ntraces; k++) {
+    const struct trace *trace = &traces[k];
+    scroller_init(&sim.sc, params, &output);
+    autoscroll_init(&sim.as, params, scroller_post, &sim.sc);
+    sim.as.wheel_hi_res = trace->wheel_hi_res;
+    sim.prev_x = sim.prev_y = 0;
+
+    uint64_t next_tick = 0;
+    for (size_t e = 0; e < trace->count; e++) {
+      const struct input_event *ev = &trace->events[e];
+      uint64_t t = ev->time.tv_usec + 1000000ull * ev->time.tv_sec;
+      if (next_tick == 0)
+        next_tick = t + TICK_INTERVAL_US;
+      for (; next_tick <= t; next_tick += TICK_INTERVAL_US)
+        sim_tick(&sim, next_tick);
+      if (!params->smooth_wheel)
+        sim_wheel(&sim, ev, trace->wheel_hi_res);
+      int was_pressed = sim.as.secondary_pressed;
+      autoscroll_handle_event(&sim.as, ev);
+      if (was_pressed && !sim.as.secondary_pressed)
+        sim.releases++;
+    }
+    for (uint64_t end = next_tick + TAIL_US; next_tick <= end;
+         next_tick += TICK_INTERVAL_US)
+      sim_tick(&sim, next_tick);
+  }
+
+  m->smoothness = sim.frames ? sqrt(sim.jerk_sum / sim.frames) : 0;
+  m->overshoot = sim.releases ? sim.after_release / sim.releases : 0;
+  m->rise_ms = step_rise_ms(params);
+
+  // Sub-tick lag from a parabola through the best delay and its neighbours.
+  // A best delay of 0 still has a neighbour on each side.
+  int best = LAG_LEAD_TICKS;
+  for (int d = 0; d < LAG_RING; d++)
+    if (sim.lag_err[d] < sim.lag_err[best])
+      best = d;
+  double offset = 0;
+  if (best > 0 && best < LAG_RING - 1) {
+    double a = sim.lag_err[best - 1], b = sim.lag_err[best],
+           c = sim.lag_err[best + 1];
+    double denom = a - 2 * b + c;
+    if (denom > 0)
+      offset = 0.5 * (a - c) / denom;
+  }
+  m->lag_ms = (best - LAG_LEAD_TICKS + offset) * TICK_INTERVAL_US / 1000.0;
+}
+
+// Work-stealing pool. Every worker owns a range of job indices, packed into
+// one atomic word as (begin << 32 | end). The owner takes jobs from the
+// front; idle workers steal the back half of another worker's range.
+
+struct worker {
+  _Alignas(64) _Atomic uint64_t range;
+  pthread_t thread;
+  int id;
+  uint64_t jobs;
+  uint64_t steals;
+};
+
+struct worker workers[MAX_WORKERS];
+int nworkers = 0;
+struct metrics *results;
+struct metrics baseline;
+double weights[3] = {1, 1, 1};
+
+static inline uint64_t pack_range(uint32_t begin, uint32_t end) {
+  return (uint64_t)begin << 32 | end;
+}
+
+static int take_job(struct worker *w, uint32_t *job) {
+  uint64_t r = atomic_load(&w->range);
+  for (;;) {
+    uint32_t begin = r >> 32, end = (uint32_t)r;
+    if (begin >= end)
+      return 0;
+    if (atomic_compare_exchange_weak(&w->range, &r,
+                                     pack_range(begin + 1, end))) {
+      *job = begin;
+      return 1;
+    }
+  }
+}
+
+static int steal_jobs(struct worker *w, struct worker *victim) {
+  uint64_t r = atomic_load(&victim->range);
+  for (;;) {
+    uint32_t begin = r >> 32, end = (uint32_t)r;
+    if (begin >= end)
+      return 0;
+    uint32_t half = (end - begin + 1) / 2;
+    if (atomic_compare_exchange_weak(&victim->range, &r,
+                                     pack_range(begin, end - half))) {
+      atomic_store(&w->range, pack_range(end - half, end));
+      w->steals++;
+      return 1;
+    }
+  }
+}
+
+static double score(const struct metrics *m) {
+  double s = 0;
+  s += weights[0] * (baseline.smoothness > 0
+                         ? m->smoothness / baseline.smoothness
+                         : m->smoothness);
+  s += weights[1] * (baseline.lag_ms != 0 ? fabs(m->lag_ms / baseline.lag_ms)
+                                          : fabs(m->lag_ms));
+  s += weights[2] * (baseline.overshoot > 0 ? m->overshoot / baseline.overshoot
+                                            : m->overshoot);
+  return s;
+}
+
+static void *worker_main(void *arg) {
+  struct worker *w = arg;
+  uint32_t job;
+  uint32_t victim = splitmix64(w->id);
+
+  for (;;) {
+    while (take_job(w, &job)) {
+      struct autoscroll_params p;
+      job_params(job, &p);
+      simulate(&p, &results[job]);
+      results[job].score = score(&results[job]);
+      w->jobs++;
+    }
+    // Out of work: look for some, starting from a random victim
+    int found = 0;
+    for (int i = 0; i < nworkers && !found; i++) {
+      struct worker *v = &workers[(victim + i) % nworkers];
+      if (v != w)
+        found = steal_jobs(w, v);
+    }
+    if (!found)
+      return NULL;
+    victim = splitmix64(victim);
+  }
+}
+
+static int compare_scores(const void *a, const void *b) {
+  double sa = results[*(const uint32_t *)a].score;
+  double sb = results[*(const uint32_t *)b].score;
+  return (sa > sb) - (sa < sb);
+}
+
+static void print_params(uint32_t job) {
+  struct autoscroll_params p;
+  job_params(job, &p);
+  for (int i = 0; i < nranges; i++) {
+    const struct param *param = ranges[i].param;
+    char *field = (char *)&p + param->offset;
+    if (param->is_int)
+      printf(" %s=%d", param->name, *(int *)field);
+    else
+      printf(" %s=%g", param->name, *(double *)field / param->scale);
+  }
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-j threads] [-n random_samples] [-S seed] [-k top]\n"
+          "          [-w smooth,lag,overshoot] -p name=lo[:hi[:steps]]... "
+          "<trace>...\n"
+          "Parameters:",
+          argv0);
+  for (unsigned i = 0; i < PARAMS_COUNT; i++)
+    fprintf(stderr, " %s", params_table[i].name);
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[]) {
+  int top = 10;
+  nworkers = sysconf(_SC_NPROCESSORS_ONLN);
+
+  int opt;
+  while ((opt = getopt(argc, argv, "j:n:S:k:w:p:")) != -1) {
+    switch (opt) {
+    case 'j':
+      nworkers = atoi(optarg);
+      break;
+    case 'n':
+      random_samples = strtoull(optarg, NULL, 10);
+      break;
+    case 'S':
+      seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'k':
+      top = atoi(optarg);
+      break;
+    case 'w':
+      if (sscanf(optarg, "%lf,%lf,%lf", &weights[0], &weights[1],
+                 &weights[2]) != 3) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'p':
+      if (parse_range(optarg) < 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind >= argc || nworkers < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (nworkers > MAX_WORKERS)
+    nworkers = MAX_WORKERS;
+  for (int i = optind; i < argc; i++) {
+    if (ntraces == MAX_TRACES || load_trace(argv[i]) < 0)
+      return 1;
+  }
+
+  uint64_t njobs = jobs_count();
+  if (njobs == 0 || njobs > UINT32_MAX) {
+    fprintf(stderr, "Search space has %llu points\n",
+                    (unsigned long long)njobs);
+    return 1;
+  }
+  results = calloc(njobs, sizeof(*results));
+  uint32_t *order = malloc(njobs * sizeof(*order));
+  if (!results || !order) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  struct autoscroll_params defaults = AUTOSCROLL_DEFAULT_PARAMS;
+  simulate(&defaults, &baseline);
+  baseline.score = score(&baseline);
+
+  // Split the jobs evenly, stealing evens out the rest
+  for (int i = 0; i < nworkers; i++) {
+    workers[i].id = i;
+    atomic_store(&workers[i].range, pack_range(njobs * i / nworkers,
+                                               njobs * (i + 1) / nworkers));
+  }
+  uint64_t start = now_ns();
+  for (int i = 0; i < nworkers; i++) {
+    if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i])) {
+      perror("pthread_create");
+      return 1;
+    }
+  }
+  uint64_t steals = 0;
+  for (int i = 0; i < nworkers; i++) {
+    pthread_join(workers[i].thread, NULL);
+    steals += workers[i].steals;
+  }
+  double elapsed = (now_ns() - start) / 1e9;
+
+  for (uint32_t i = 0; i < njobs; i++)
+    order[i] = i;
+  qsort(order, njobs, sizeof(*order), compare_scores);
+
+  printf("%llu simulations x %llu events on %d threads: %.2f s, "
+         "%.0f simulations/sec, %.1fM events/sec, %llu steals\n",
+         (unsigned long long)njobs, (unsigned long long)total_events,
+         nworkers, elapsed, njobs / elapsed,
+         njobs * total_events / elapsed / 1e6, (unsigned long long)steals);
+  printf("%-4s %7s %9s %8s %10s %8s\n", "rank", "score", "smooth", "lag_ms",
+         "overshoot", "rise_ms");
+  printf("%-4s %7.3f %9.3f %8.2f %10.1f %8.0f  defaults\n", "-",
+         baseline.score, baseline.smoothness, baseline.lag_ms,
+         baseline.overshoot, baseline.rise_ms);
+  for (uint32_t i = 0; i < njobs && i < (uint32_t)top; i++) {
+    struct metrics *m = &results[order[i]];
+    printf("%-4u %7.3f %9.3f %8.2f %10.1f %8.0f ", i + 1, m->score,
+           m->smoothness, m->lag_ms, m->overshoot, m->rise_ms);
+    print_params(order[i]);
+    printf("\n");
+  }
+  return 0;
+}
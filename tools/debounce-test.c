@@ -0,0 +1,228 @@
+// Replays synthetic button chatter through the event handling core with
+// debouncing on (-d), ticking every TICK_INTERVAL_US as the daemon does, and
+// checks the button edges that come out. Exits non-zero if any case fails.
+//
+//   make tools/debounce-test && tools/debounce-test
+
+#include "../autoscroll.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WINDOW_US 10000
+#define BASE_US 1000000000ull // event times far from 0
+#define MAX_EDGES 64
+// Latest a correction can come after the edge it corrects, in ms
+#define LATE_MS ((WINDOW_US + TICK_INTERVAL_US) / 1000.0)
+
+#define TICK -1 // step type: a tick at this time, as from the daemon's clock
+#define HELD -1 // edge code: as.secondary_pressed changed (scrolling)
+
+struct step {
+  double ms; // after BASE_US
+  int type, code, value;
+};
+
+struct edge {
+  uint64_t us;
+  int code, value;
+};
+
+// Expected edge, at ms_min to ms_max after BASE_US
+struct expect {
+  int code, value;
+  double ms_min, ms_max;
+};
+
+struct autoscroll as;
+struct scroller sc;
+uint64_t now, next_tick;
+struct edge edges[MAX_EDGES];
+int nedges, held;
+
+static void record(int code, int value) {
+  if (nedges < MAX_EDGES)
+    edges[nedges++] = (struct edge){now, code, value};
+}
+
+static void test_write(void *data, int device, unsigned int type,
+                       unsigned int code, int value) {
+  if (device == OUTPUT_MOUSE && type == EV_KEY)
+    record(code, value);
+}
+
+static void test_sleep(void *data, uint64_t us) {}
+
+static void check_held(void) {
+  if (as.secondary_pressed != held) {
+    held = as.secondary_pressed;
+    record(HELD, held);
+  }
+}
+
+static void tick(uint64_t t) {
+  now = t;
+  autoscroll_tick(&as, t);
+  scroller_tick(&sc, t);
+  check_held();
+}
+
+static void tick_until(uint64_t t) {
+  for (; next_tick <= t; next_tick += TICK_INTERVAL_US)
+    tick(next_tick);
+}
+
+static void input(uint64_t t, int type, int code, int value) {
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.time.tv_sec = t / 1000000;
+  ev.time.tv_usec = t % 1000000;
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  now = t;
+  autoscroll_handle_event(&as, &ev);
+  check_held();
+}
+
+static uint64_t at(double ms) { return BASE_US + (uint64_t)(ms * 1000); }
+
+static void run(const struct step *steps, int n, double end_ms) {
+  struct autoscroll_params params = AUTOSCROLL_DEFAULT_PARAMS;
+  params.debounce_us = WINDOW_US;
+  struct autoscroll_output output = {test_write, test_sleep, NULL};
+  scroller_init(&sc, &params, &output);
+  autoscroll_init(&as, &params, scroller_post, &sc);
+  nedges = held = 0;
+  next_tick = BASE_US;
+
+  for (int i = 0; i < n; i++) {
+    uint64_t t = at(steps[i].ms);
+    if (steps[i].type == TICK) {
+      tick(t);
+      continue;
+    }
+    tick_until(t);
+    input(t, steps[i].type, steps[i].code, steps[i].value);
+    input(t, EV_SYN, SYN_REPORT, 0);
+  }
+  tick_until(at(end_ms));
+}
+
+static const char *edge_name(int code) {
+  return code == BTN_LEFT ? "left" : code == BTN_RIGHT ? "right" : "held";
+}
+
+static int check(const char *name, const struct expect *expect, int n) {
+  int ok = nedges == n;
+  for (int i = 0; ok && i < n; i++) {
+    ok = edges[i].code == expect[i].code &&
+         edges[i].value == expect[i].value &&
+         edges[i].us >= at(expect[i].ms_min) &&
+         edges[i].us <= at(expect[i].ms_max);
+  }
+  printf("%-4s %-26s", ok ? "ok" : "FAIL", name);
+  for (int i = 0; i < nedges; i++)
+    printf(" %s %d@%.1f", edge_name(edges[i].code), edges[i].value,
+           (edges[i].us - BASE_US) / 1000.0);
+  printf("\n");
+  return !ok;
+}
+
+// Right press, then enough motion to start scrolling
+static int start_scroll(struct step *steps) {
+  int n = 0;
+  steps[n++] = (struct step){0, EV_KEY, BTN_RIGHT, 1};
+  for (int i = 1; i <= 40; i++)
+    steps[n++] = (struct step){i, EV_REL, REL_Y, 3};
+  return n;
+}
+
+int main(void) {
+  int failed = 0;
+
+  // Passes at once
+  static const struct step clean[] = {{0, EV_KEY, BTN_LEFT, 1},
+                                      {80, EV_KEY, BTN_LEFT, 0}};
+  static const struct expect clean_out[] = {{BTN_LEFT, 1, 0, 0},
+                                            {BTN_LEFT, 0, 80, 80}};
+  run(clean, 2, 200);
+  failed |= check("clean click", clean_out, 2);
+
+  // Contact bounce after the press and after the release
+  static const struct step bounce[] = {
+      {0, EV_KEY, BTN_LEFT, 1},   {1, EV_KEY, BTN_LEFT, 0},
+      {2, EV_KEY, BTN_LEFT, 1},   {3, EV_KEY, BTN_LEFT, 0},
+      {4, EV_KEY, BTN_LEFT, 1},   {100, EV_KEY, BTN_LEFT, 0},
+      {101, EV_KEY, BTN_LEFT, 1}, {103, EV_KEY, BTN_LEFT, 0}};
+  static const struct expect bounce_out[] = {{BTN_LEFT, 1, 0, 0},
+                                             {BTN_LEFT, 0, 100, 100}};
+  run(bounce, 8, 300);
+  failed |= check("bounce at both edges", bounce_out, 2);
+
+  // Released within the window: corrected when it ends
+  static const struct step fast[] = {{0, EV_KEY, BTN_LEFT, 1},
+                                     {4, EV_KEY, BTN_LEFT, 0}};
+  static const struct expect fast_out[] = {{BTN_LEFT, 1, 0, 0},
+                                           {BTN_LEFT, 0, 10, LATE_MS}};
+  run(fast, 2, 100);
+  failed |= check("click shorter than window", fast_out, 2);
+
+  // Dragging with a worn left switch: the first bounce gets through and is
+  // corrected, later ones are held back, as is the final release
+  static const struct step hold[] = {
+      {0, EV_KEY, BTN_LEFT, 1},    {500, EV_KEY, BTN_LEFT, 0},
+      {502, EV_KEY, BTN_LEFT, 1},  {1000, EV_KEY, BTN_LEFT, 0},
+      {1003, EV_KEY, BTN_LEFT, 1}, {1500, EV_KEY, BTN_LEFT, 0},
+      {1501, EV_KEY, BTN_LEFT, 1}, {1502, EV_KEY, BTN_LEFT, 0},
+      {1504, EV_KEY, BTN_LEFT, 1}, {2000, EV_KEY, BTN_LEFT, 0}};
+  static const struct expect hold_out[] = {
+      {BTN_LEFT, 1, 0, 0},
+      {BTN_LEFT, 0, 500, 500},
+      {BTN_LEFT, 1, 510, 500 + LATE_MS},
+      {BTN_LEFT, 0, 2010, 2000 + LATE_MS}};
+  run(hold, 10, 3000);
+  failed |= check("chatter mid-hold", hold_out, 4);
+
+  // Scrolling with a worn right switch: no bounce ends the scroll, not even
+  // the first
+  struct step scroll[64];
+  int n = start_scroll(scroll);
+  scroll[n++] = (struct step){500, EV_KEY, BTN_RIGHT, 0};
+  scroll[n++] = (struct step){502, EV_KEY, BTN_RIGHT, 1};
+  scroll[n++] = (struct step){1000, EV_KEY, BTN_RIGHT, 0};
+  scroll[n++] = (struct step){1001, EV_KEY, BTN_RIGHT, 1};
+  scroll[n++] = (struct step){1002, EV_KEY, BTN_RIGHT, 0};
+  scroll[n++] = (struct step){1004, EV_KEY, BTN_RIGHT, 1};
+  scroll[n++] = (struct step){2000, EV_KEY, BTN_RIGHT, 0};
+  static const struct expect scroll_out[] = {{HELD, 1, 0, 0},
+                                             {HELD, 0, 2010, 2000 + LATE_MS}};
+  run(scroll, n, 3000);
+  failed |= check("chatter mid-scroll", scroll_out, 2);
+
+  // A correction made on a tick, then a bounce read after it but stamped
+  // before it by the kernel: still inside the window
+  static const struct step stamp[] = {
+      {0, EV_KEY, BTN_LEFT, 1},    {3, EV_KEY, BTN_LEFT, 0},
+      {12, TICK},                  {11.5, EV_KEY, BTN_LEFT, 1},
+      {13, EV_KEY, BTN_LEFT, 0}};
+  static const struct expect stamp_out[] = {{BTN_LEFT, 1, 0, 0},
+                                            {BTN_LEFT, 0, 12, 12}};
+  run(stamp, 5, 100);
+  failed |= check("event older than a tick", stamp_out, 2);
+
+  // Releases are only held back for DEBOUNCE_CHATTER_US after a bounce
+  static const struct step decay[] = {
+      {0, EV_KEY, BTN_LEFT, 1},    {100, EV_KEY, BTN_LEFT, 0},
+      {102, EV_KEY, BTN_LEFT, 1},  {200, EV_KEY, BTN_LEFT, 0},
+      {4000, EV_KEY, BTN_LEFT, 1}, {4100, EV_KEY, BTN_LEFT, 0}};
+  static const struct expect decay_out[] = {
+      {BTN_LEFT, 1, 0, 0},         {BTN_LEFT, 0, 100, 100},
+      {BTN_LEFT, 1, 110, 100 + LATE_MS}, {BTN_LEFT, 0, 210, 200 + LATE_MS},
+      {BTN_LEFT, 1, 4000, 4000},   {BTN_LEFT, 0, 4100, 4100}};
+  run(decay, 6, 4300);
+  failed |= check("chatter decays", decay_out, 6);
+
+  if (failed)
+    fprintf(stderr, "Debounce test failed\n");
+  return failed;
+}
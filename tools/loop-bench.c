@@ -0,0 +1,326 @@
+#define _GNU_SOURCE
+
+// Compares the poll() and io_uring event loops by replaying recorded evdev
+// traces (or synthetic traffic) into a pipe standing in for the device, with
+// both output devices on /dev/null. Reports syscalls and CPU time of the
+// loop, not counting the replaying thread.
+//
+//   tools/loop-bench [-x speed] [-l loops] [trace...]
+//
+// /dev/null accepts non-blocking writes, so io_uring writes complete inline
+// here; uinput does not, and its writes go through io_uring's worker threads.
+
+#include "../autoscroll.h"
+#include "../uring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_TRACES 64
+
+static inline uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000ull;
+}
+
+static uint64_t timeval_us(struct timeval tv) {
+  return (uint64_t)tv.tv_sec * 1000000ull + tv.tv_usec;
+}
+
+double speed = 1;
+int loops = 1;
+
+// Traces
+
+struct trace {
+  struct input_event *events;
+  size_t count;
+};
+
+struct trace traces[MAX_TRACES];
+int ntraces = 0;
+
+static int load_trace(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (size <= 0 || size % sizeof(struct input_event) != 0) {
+    fprintf(stderr, "%s: not a trace of struct input_event\n", path);
+    fclose(f);
+    return -1;
+  }
+  struct trace *t = &traces[ntraces++];
+  t->count = size / sizeof(struct input_event);
+  t->events = malloc(size);
+  if (!t->events || fread(t->events, 1, size, f) != (size_t)size) {
+    fprintf(stderr, "%s: read failed\n", path);
+    fclose(f);
+    return -1;
+  }
+  fclose(f);
+  return 0;
+}
+
+static void push(struct trace *t, uint64_t time_us, int type, int code,
+                 int value) {
+  struct input_event *ev = &t->events[t->count++];
+  memset(ev, 0, sizeof(*ev));
+  ev->time.tv_sec = time_us / 1000000;
+  ev->time.tv_usec = time_us % 1000000;
+  ev->type = type;
+  ev->code = code;
+  ev->value = value;
+}
+
+// 1 kHz motion for 6 s, holding the secondary button (scrolling) from 1 s to
+// 5 s
+static void synthetic_trace(void) {
+  struct trace *t = &traces[ntraces++];
+  t->events = malloc(6000 * 4 * sizeof(*t->events));
+  t->count = 0;
+  for (int ms = 0; ms < 6000; ms++) {
+    uint64_t time = ms * 1000ull;
+    if (ms == 1000 || ms == 5000) {
+      push(t, time, EV_KEY, BTN_RIGHT, ms == 1000);
+      push(t, time, EV_SYN, SYN_REPORT, 0);
+    }
+    push(t, time, EV_REL, REL_X, (ms / 250) % 2 ? 3 : -3);
+    push(t, time, EV_REL, REL_Y, (ms / 400) % 2 ? 2 : -2);
+    push(t, time, EV_SYN, SYN_REPORT, 0);
+  }
+}
+
+// Replay
+
+int pipe_fds[2];
+uint64_t replay_cpu_us;
+
+static void *replay_main(void *data) {
+  uint64_t start = now_us(), offset = 0;
+  for (int loop = 0; loop < loops; loop++) {
+    for (int k = 0; k < ntraces; k++) {
+      const struct trace *t = &traces[k];
+      uint64_t t0 = timeval_us(t->events[0].time);
+      uint64_t last = 0;
+      size_t begin = 0;
+      for (size_t i = 0; i < t->count; i++) {
+        const struct input_event *ev = &t->events[i];
+        if (ev->type != EV_SYN || ev->code != SYN_REPORT)
+          continue;
+        // Write each report at its recorded time, stamped with the current
+        // time like the kernel does
+        last = (timeval_us(ev->time) - t0) / speed;
+        uint64_t due = start + offset + last;
+        struct timespec ts = {due / 1000000, (due % 1000000) * 1000};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        struct input_event report[64];
+        size_t n = i + 1 - begin;
+        if (n > 64)
+          n = 64;
+        memcpy(report, &t->events[i + 1 - n], n * sizeof(*report));
+        uint64_t now = now_us();
+        for (size_t j = 0; j < n; j++) {
+          report[j].time.tv_sec = now / 1000000;
+          report[j].time.tv_usec = now % 1000000;
+        }
+        write(pipe_fds[1], report, n * sizeof(*report));
+        begin = i + 1;
+      }
+      offset += last + TICK_INTERVAL_US;
+    }
+  }
+  struct rusage ru;
+  getrusage(RUSAGE_THREAD, &ru);
+  replay_cpu_us = timeval_us(ru.ru_utime) + timeval_us(ru.ru_stime);
+  close(pipe_fds[1]);
+  return NULL;
+}
+
+// Backends
+
+struct result {
+  uint64_t events, syscalls, wakeups, ticks;
+};
+
+struct autoscroll as;
+struct scroller scroller;
+int out_fds[2];
+uint64_t syscalls;
+
+// As libevdev_uinput_write_event(): one write per event
+static void poll_write(void *data, int device, unsigned int type,
+                       unsigned int code, int value) {
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  write(out_fds[device], &ev, sizeof(ev));
+  syscalls++;
+}
+
+static void poll_sleep(void *data, uint64_t us) {
+  struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+  nanosleep(&ts, NULL);
+  syscalls++;
+}
+
+static void run_poll(struct result *r) {
+  struct autoscroll_params params = AUTOSCROLL_DEFAULT_PARAMS;
+  struct autoscroll_output output = {poll_write, poll_sleep, NULL};
+  scroller_init(&scroller, &params, &output);
+  autoscroll_init(&as, &params, scroller_post, &scroller);
+  fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+
+  int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  struct itimerspec ts = {{0, TICK_INTERVAL_US * 1000},
+                          {0, TICK_INTERVAL_US * 1000}};
+  timerfd_settime(tfd, 0, &ts, NULL);
+  syscalls = 0;
+
+  struct pollfd fds[2] = {{pipe_fds[0], POLLIN, 0}, {tfd, POLLIN, 0}};
+  while (1) {
+    syscalls++;
+    r->wakeups++;
+    if (poll(fds, 2, -1) == -1 && errno != EINTR)
+      break;
+    if (fds[0].revents & (POLLIN | POLLHUP)) {
+      // As libevdev_next_event(): read until EAGAIN
+      struct input_event evs[64];
+      ssize_t n;
+      while ((n = read(pipe_fds[0], evs, sizeof(evs))) > 0) {
+        syscalls++;
+        for (ssize_t i = 0; i < n / (ssize_t)sizeof(*evs); i++)
+          autoscroll_handle_event(&as, &evs[i]);
+        r->events += n / sizeof(*evs);
+      }
+      syscalls++;
+      if (n == 0)
+        break;
+    }
+    if (fds[1].revents & POLLIN) {
+      uint64_t expirations;
+      read(tfd, &expirations, sizeof(expirations));
+      syscalls++;
+      r->ticks++;
+      scroller_tick(&scroller, now_us());
+    }
+  }
+  r->syscalls = syscalls;
+  close(tfd);
+}
+
+static void uring_event(void *data, const struct input_event *ev) {
+  autoscroll_handle_event(&as, ev);
+}
+
+static void uring_tick(void *data, uint64_t now) {
+  scroller_tick(&scroller, now);
+}
+
+static void run_uring(struct result *r) {
+  static struct uring_loop loop;
+  int rc = uring_loop_init(&loop, pipe_fds[0], out_fds);
+  if (rc < 0) {
+    fprintf(stderr, "io_uring unavailable: %s\n", strerror(-rc));
+    exit(1);
+  }
+  struct autoscroll_params params = AUTOSCROLL_DEFAULT_PARAMS;
+  struct autoscroll_output output = {uring_loop_write, uring_loop_sleep,
+                                     &loop};
+  scroller_init(&scroller, &params, &output);
+  autoscroll_init(&as, &params, scroller_post, &scroller);
+  loop.on_event = uring_event;
+  loop.on_tick = uring_tick;
+  loop.tick_interval_us = TICK_INTERVAL_US;
+
+  uring_loop_run(&loop);
+  r->events = loop.stats.events;
+  r->syscalls = loop.stats.enters;
+  r->wakeups = loop.stats.wakeups;
+  r->ticks = loop.stats.ticks;
+  uring_loop_free(&loop);
+}
+
+static void run(const char *name, void (*backend)(struct result *)) {
+  struct result r = {0};
+  pthread_t replayer;
+  if (pipe(pipe_fds) < 0) {
+    perror("pipe");
+    exit(1);
+  }
+
+  struct rusage before, after;
+  getrusage(RUSAGE_SELF, &before);
+  uint64_t start = now_us();
+  pthread_create(&replayer, NULL, replay_main, NULL);
+  backend(&r);
+  pthread_join(replayer, NULL);
+  uint64_t wall = now_us() - start;
+  getrusage(RUSAGE_SELF, &after);
+  close(pipe_fds[0]);
+
+  uint64_t cpu = timeval_us(after.ru_utime) + timeval_us(after.ru_stime) -
+                 timeval_us(before.ru_utime) - timeval_us(before.ru_stime) -
+                 replay_cpu_us;
+  double seconds = wall / 1e6;
+  printf("%-9s %8llu events %6llu ticks %8llu wakeups %8llu syscalls "
+         "(%6.0f/s, %.2f/event) %7.1f ms cpu (%.2f us/event)\n",
+         name, (unsigned long long)r.events, (unsigned long long)r.ticks,
+         (unsigned long long)r.wakeups, (unsigned long long)r.syscalls,
+         r.syscalls / seconds, (double)r.syscalls / r.events, cpu / 1000.0,
+         (double)cpu / r.events);
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  while ((opt = getopt(argc, argv, "x:l:")) != -1) {
+    switch (opt) {
+    case 'x':
+      speed = atof(optarg);
+      break;
+    case 'l':
+      loops = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-x speed] [-l loops] [trace...]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  if (speed <= 0 || loops < 1) {
+    fprintf(stderr, "Speed and loops must be positive\n");
+    return 1;
+  }
+  for (int i = optind; i < argc; i++) {
+    if (ntraces == MAX_TRACES || load_trace(argv[i]) < 0)
+      return 1;
+  }
+  if (!ntraces)
+    synthetic_trace();
+
+  out_fds[OUTPUT_MOUSE] = open("/dev/null", O_WRONLY);
+  out_fds[OUTPUT_KEYBOARD] = open("/dev/null", O_WRONLY);
+  if (out_fds[0] < 0 || out_fds[1] < 0) {
+    perror("/dev/null");
+    return 1;
+  }
+
+  run("poll", run_poll);
+  run("io_uring", run_uring);
+  return 0;
+}
@@ -0,0 +1,279 @@
+#define _GNU_SOURCE
+
+// Compares the single-threaded event loop with the two-thread pipeline under
+// synthetic load: steady pointer motion with periodic bursts, written into a
+// pipe standing in for the device, and an output device whose writes cost
+// some time and occasionally stall. Reports frame lateness and the time from
+// an event being generated to it being re-emitted.
+//
+//   tools/pipeline-bench [-r rate_hz] [-b burst] [-w write_ns] [-s stall_us]
+//                        [-d seconds]
+
+#include "../autoscroll.h"
+#include "../pipeline.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HISTORY 65536
+#define MAX_SAMPLES 4000000
+#define BURST_INTERVAL_US 100000
+#define STALL_EVERY 1000
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int rate_hz = 1000;
+int burst = 500;
+int write_ns = 2000;
+int stall_us = 2000;
+int seconds = 3;
+
+// Load
+
+uint64_t sent_at_ns[HISTORY];
+int pipe_fds[2];
+volatile int generating;
+
+static void send_motion(uint32_t *seq) {
+  struct input_event ev[2];
+  memset(ev, 0, sizeof(ev));
+  uint64_t t = now_ns();
+  ev[0].time.tv_sec = t / 1000000000;
+  ev[0].time.tv_usec = (t % 1000000000) / 1000;
+  ev[0].type = EV_REL;
+  ev[0].code = REL_X;
+  ev[0].value = *seq % HISTORY;
+  ev[1].time = ev[0].time;
+  ev[1].type = EV_SYN;
+  ev[1].code = SYN_REPORT;
+  sent_at_ns[*seq % HISTORY] = t;
+  (*seq)++;
+  write(pipe_fds[1], ev, sizeof(ev));
+}
+
+static void *generator_main(void *data) {
+  uint32_t seq = 1;
+  uint64_t interval_ns = 1000000000ull / rate_hz;
+  uint64_t next = now_ns(), next_burst = next + BURST_INTERVAL_US * 1000ull;
+  while (generating) {
+    send_motion(&seq);
+    if (now_ns() >= next_burst) {
+      for (int i = 0; i < burst; i++)
+        send_motion(&seq);
+      next_burst += BURST_INTERVAL_US * 1000ull;
+    }
+    next += interval_ns;
+    struct timespec ts = {next / 1000000000, next % 1000000000};
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+  }
+  return NULL;
+}
+
+// Output device
+
+uint64_t *latencies;
+size_t nlatencies;
+uint64_t writes;
+
+static void spin_ns(uint64_t ns) {
+  uint64_t end = now_ns() + ns;
+  while (now_ns() < end)
+    ;
+}
+
+static void bench_write(void *data, int device, unsigned int type,
+                        unsigned int code, int value) {
+  spin_ns(write_ns);
+  if (++writes % STALL_EVERY == 0)
+    spin_ns(stall_us * 1000ull);
+  if (type == EV_REL && code == REL_X && value > 0 &&
+      nlatencies < MAX_SAMPLES)
+    latencies[nlatencies++] = now_ns() - sent_at_ns[value];
+}
+
+static void bench_sleep(void *data, uint64_t us) {
+  struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+  nanosleep(&ts, NULL);
+}
+
+// Event loops, as in mouse-autoscroll.c
+
+struct result {
+  uint64_t ticks, late_sum_us, late_max_us;
+};
+
+static int read_events(struct autoscroll *as) {
+  struct input_event evs[64];
+  ssize_t n = read(pipe_fds[0], evs, sizeof(evs));
+  for (ssize_t i = 0; i < n / (ssize_t)sizeof(*evs); i++)
+    autoscroll_handle_event(as, &evs[i]);
+  return n > 0;
+}
+
+static void run_single(const struct autoscroll_params *params,
+                       const struct autoscroll_output *output,
+                       struct result *r) {
+  static struct autoscroll as;
+  static struct scroller scroller;
+  scroller_init(&scroller, params, output);
+  autoscroll_init(&as, params, scroller_post, &scroller);
+
+  int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  struct itimerspec ts = {{0, TICK_INTERVAL_US * 1000},
+                          {0, TICK_INTERVAL_US * 1000}};
+  timerfd_settime(tfd, 0, &ts, NULL);
+  uint64_t expected = now_ns() / 1000 + TICK_INTERVAL_US;
+  uint64_t end = now_ns() + seconds * 1000000000ull;
+
+  struct pollfd fds[2] = {{pipe_fds[0], POLLIN, 0}, {tfd, POLLIN, 0}};
+  while (now_ns() < end) {
+    if (poll(fds, 2, -1) == -1 && errno != EINTR)
+      break;
+    if (fds[0].revents & POLLIN)
+      while (read_events(&as))
+        ;
+    if (fds[1].revents & POLLIN) {
+      uint64_t expirations;
+      read(tfd, &expirations, sizeof(expirations));
+      uint64_t t = now_ns() / 1000;
+      uint64_t late = t > expected ? t - expected : 0;
+      expected += expirations * TICK_INTERVAL_US;
+      r->ticks++;
+      r->late_sum_us += late;
+      if (late > r->late_max_us)
+        r->late_max_us = late;
+      scroller_tick(&scroller, t);
+    }
+  }
+  close(tfd);
+}
+
+static void run_threaded(const struct autoscroll_params *params,
+                         const struct autoscroll_output *output,
+                         struct result *r) {
+  static struct autoscroll as;
+  static struct pipeline pipeline;
+  pipeline_init(&pipeline, params, output);
+  pipeline_start(&pipeline);
+  autoscroll_init(&as, params, pipeline_post, &pipeline);
+  uint64_t end = now_ns() + seconds * 1000000000ull;
+
+  struct pollfd fds[1] = {{pipe_fds[0], POLLIN, 0}};
+  while (now_ns() < end) {
+    if (poll(fds, 1, 100) == -1 && errno != EINTR)
+      break;
+    if (fds[0].revents & POLLIN) {
+      while (read_events(&as))
+        ;
+      pipeline_flush(&pipeline);
+    }
+  }
+  pipeline_stop(&pipeline);
+  r->ticks = pipeline.stats.ticks;
+  r->late_sum_us = pipeline.stats.late_sum_us;
+  r->late_max_us = pipeline.stats.late_max_us;
+  printf("  queue: max depth %u, full %llu times\n", pipeline.stats.queue_max,
+         (unsigned long long)pipeline.stats.full_waits);
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void run(const char *name,
+                void (*loop)(const struct autoscroll_params *,
+                             const struct autoscroll_output *,
+                             struct result *)) {
+  struct autoscroll_params params = AUTOSCROLL_DEFAULT_PARAMS;
+  struct autoscroll_output output = {bench_write, bench_sleep, NULL};
+  struct result r = {0};
+  pthread_t generator;
+
+  if (pipe(pipe_fds) < 0) {
+    perror("pipe");
+    exit(1);
+  }
+  fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+  nlatencies = 0;
+  writes = 0;
+  generating = 1;
+  pthread_create(&generator, NULL, generator_main, NULL);
+  printf("%s:\n", name);
+  loop(&params, &output, &r);
+  generating = 0;
+  // Unblock the generator if the pipe is full
+  char buf[4096];
+  while (pthread_tryjoin_np(generator, NULL) != 0)
+    read(pipe_fds[0], buf, sizeof(buf));
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+
+  qsort(latencies, nlatencies, sizeof(*latencies), compare_u64);
+  printf("  ticks: %llu, late by %.1f us on average, %llu us at worst\n",
+         (unsigned long long)r.ticks,
+         r.ticks ? (double)r.late_sum_us / r.ticks : 0,
+         (unsigned long long)r.late_max_us);
+  if (nlatencies)
+    printf("  event latency: p50 %.1f us, p99 %.1f us, max %.1f us "
+           "(%zu events)\n",
+           latencies[nlatencies / 2] / 1000.0,
+           latencies[nlatencies * 99 / 100] / 1000.0,
+           latencies[nlatencies - 1] / 1000.0, nlatencies);
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  while ((opt = getopt(argc, argv, "r:b:w:s:d:")) != -1) {
+    switch (opt) {
+    case 'r':
+      rate_hz = atoi(optarg);
+      break;
+    case 'b':
+      burst = atoi(optarg);
+      break;
+    case 'w':
+      write_ns = atoi(optarg);
+      break;
+    case 's':
+      stall_us = atoi(optarg);
+      break;
+    case 'd':
+      seconds = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [-r rate_hz] [-b burst] [-w write_ns] [-s stall_us] "
+              "[-d seconds]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  if (rate_hz < 1) {
+    fprintf(stderr, "Rate must be positive\n");
+    return 1;
+  }
+  latencies = malloc(MAX_SAMPLES * sizeof(*latencies));
+  if (!latencies) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  printf("%d Hz motion, bursts of %d every %d ms, %d ns per write, "
+         "%d us stall every %d writes\n",
+         rate_hz, burst, BURST_INTERVAL_US / 1000, write_ns, stall_us,
+         STALL_EVERY);
+  run("single thread", run_single);
+  run("reader + emitter threads", run_threaded);
+  return 0;
+}
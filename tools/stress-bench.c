@@ -0,0 +1,489 @@
+#define _GNU_SOURCE
+
+// Stress test of the event handling core at high polling rates. A generator
+// thread produces synthetic motion, button and wheel reports for several
+// simulated devices, at up to 8 kHz each, into in-memory queues standing in
+// for the evdev devices. A consumer thread runs the daemon's loop over them:
+// it drains the queues through one core (struct autoscroll + struct scroller)
+// per device, ticks every TICK_INTERVAL_US and writes output into memory.
+//
+//   tools/stress-bench [-n devices,...] [-r rate_hz,...] [-d seconds]
+//                      [-b button_cycle_ms] [-w wheel_interval_ms] [-c]
+//
+// Every devices x rate point reports consumer CPU per event, queue depth
+// (events waiting when the consumer gets to them) and tick lateness. Then one
+// unpaced run per device count, handling pre-generated events as fast as
+// possible, gives the highest sustainable rate. -c prints CSV, to track the
+// curve across releases.
+//
+// Each device holds its secondary button (scrolling) for the middle half of
+// every button cycle and turns the wheel every wheel interval otherwise.
+// libevdev and uinput costs are not included, see tools/loop-bench for those.
+
+#include "../autoscroll.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_DEVICES 16
+#define MAX_POINTS 16
+#define QUEUE_SIZE 16384 // events per device, power of two
+#define REPORT_MAX 8     // events per report
+#define GEN_QUANTUM_NS 125000ull // the generator wakes at most at 8 kHz
+#define MAX_TICKS 1000000
+#define UNPACED_CHUNK_MS 100
+#define UNPACED_CPU_NS 500000000ull // per device count
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Exact, unlike getrusage() which counts in scheduler ticks
+static uint64_t thread_cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+int device_counts[MAX_POINTS] = {1, 2, 4, 8}, ndevice_counts = 4;
+int rates[MAX_POINTS] = {1000, 2000, 4000, 8000}, nrates = 4;
+int seconds = 1;
+int button_cycle_ms = 2000;
+int wheel_interval_ms = 100;
+int csv = 0;
+
+// Simulated devices
+
+struct queue {
+  struct input_event evs[QUEUE_SIZE];
+  _Alignas(64) _Atomic uint32_t head; // next slot the generator writes
+  _Alignas(64) _Atomic uint32_t tail; // next slot the consumer reads
+};
+
+struct device {
+  struct queue queue;
+  struct autoscroll as;
+  struct scroller sc;
+
+  // Generator side
+  uint64_t next_ns; // next report due
+  uint64_t generated, dropped; // events
+  int held;
+  uint64_t wheel_slot;
+
+  // Output sink
+  struct input_event out[64];
+  uint64_t writes;
+};
+
+struct device *devices;
+int ndevices;
+uint64_t start_ns, end_ns, period_ns;
+
+static void sink_write(void *data, int device, unsigned int type,
+                       unsigned int code, int value) {
+  struct device *d = data;
+  struct input_event *ev = &d->out[d->writes++ % 64];
+  ev->type = type;
+  ev->code = code;
+  ev->value = value;
+}
+
+// Wheel events focus the window first, which sleeps 1 ms in the daemon. Not
+// here, it would only measure the sleep.
+static void sink_sleep(void *data, uint64_t us) {}
+
+static void init_devices(int n) {
+  struct autoscroll_params params = AUTOSCROLL_DEFAULT_PARAMS;
+  ndevices = n;
+  memset(devices, 0, n * sizeof(*devices));
+  for (int i = 0; i < n; i++) {
+    struct device *d = &devices[i];
+    struct autoscroll_output output = {sink_write, sink_sleep, d};
+    scroller_init(&d->sc, &params, &output);
+    autoscroll_init(&d->as, &params, scroller_post, &d->sc);
+  }
+}
+
+static void set_event(struct input_event *ev, uint64_t t_ns, int type,
+                      int code, int value) {
+  memset(ev, 0, sizeof(*ev));
+  ev->time.tv_sec = t_ns / 1000000000;
+  ev->time.tv_usec = (t_ns % 1000000000) / 1000;
+  ev->type = type;
+  ev->code = code;
+  ev->value = value;
+}
+
+// The report of device d due at t_ns, into evs. Returns its event count.
+static int make_report(struct device *d, uint64_t t_ns,
+                       struct input_event *evs) {
+  uint64_t ms = (t_ns - start_ns) / 1000000;
+  int n = 0;
+  if (button_cycle_ms > 0) {
+    int phase = ms % button_cycle_ms;
+    int held = phase >= button_cycle_ms / 4 && phase < button_cycle_ms * 3 / 4;
+    if (held != d->held) {
+      set_event(&evs[n++], t_ns, EV_KEY, BTN_RIGHT, held);
+      d->held = held;
+    }
+  }
+  if (wheel_interval_ms > 0 && !d->held &&
+      ms / wheel_interval_ms != d->wheel_slot) {
+    d->wheel_slot = ms / wheel_interval_ms;
+    set_event(&evs[n++], t_ns, EV_REL, REL_WHEEL, -1);
+    set_event(&evs[n++], t_ns, EV_REL, REL_WHEEL_HI_RES, -120);
+  }
+  // High rate mice report small steps
+  set_event(&evs[n++], t_ns, EV_REL, REL_X, (ms / 250) % 2 ? 1 : -1);
+  set_event(&evs[n++], t_ns, EV_REL, REL_Y, (ms / 400) % 2 ? 1 : -1);
+  set_event(&evs[n++], t_ns, EV_SYN, SYN_REPORT, 0);
+  return n;
+}
+
+// Generator
+
+int event_fd;
+atomic_int generating;
+
+static void push_report(struct device *d, uint64_t t_ns) {
+  struct input_event evs[REPORT_MAX];
+  int n = make_report(d, t_ns, evs);
+  struct queue *q = &d->queue;
+  uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+  d->generated += n;
+  if (head - tail + n > QUEUE_SIZE) {
+    d->dropped += n; // as the kernel does when its buffer is full
+    return;
+  }
+  for (int i = 0; i < n; i++)
+    q->evs[(head + i) % QUEUE_SIZE] = evs[i];
+  atomic_store_explicit(&q->head, head + n, memory_order_release);
+}
+
+static void *generator_main(void *data) {
+  for (int i = 0; i < ndevices; i++) // spread over the polling interval
+    devices[i].next_ns = start_ns + period_ns * i / ndevices;
+  while (1) {
+    uint64_t now = now_ns(), next = UINT64_MAX;
+    int pushed = 0;
+    for (int i = 0; i < ndevices; i++) {
+      struct device *d = &devices[i];
+      for (; d->next_ns <= now && d->next_ns < end_ns; d->next_ns += period_ns) {
+        push_report(d, d->next_ns);
+        pushed = 1;
+      }
+      if (d->next_ns < next)
+        next = d->next_ns;
+    }
+    if (pushed)
+      eventfd_write(event_fd, 1);
+    if (next >= end_ns)
+      break;
+    next = (next + GEN_QUANTUM_NS - 1) / GEN_QUANTUM_NS * GEN_QUANTUM_NS;
+    struct timespec ts = {next / 1000000000, next % 1000000000};
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+  }
+  atomic_store(&generating, 0);
+  eventfd_write(event_fd, 1);
+  return NULL;
+}
+
+// Consumer, as the daemon's poll() loop
+
+struct result {
+  uint64_t generated, dropped, handled;
+  uint64_t cpu_ns, wall_us;
+  uint32_t queue_max, queue_p99;
+  uint64_t ticks, late_p50_us, late_p99_us, late_max_us;
+};
+
+uint64_t depth_hist[QUEUE_SIZE + 1];
+uint64_t *lateness;
+
+static uint64_t drain(void) {
+  uint64_t handled = 0;
+  for (int i = 0; i < ndevices; i++) {
+    struct device *d = &devices[i];
+    struct queue *q = &d->queue;
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (head == tail)
+      continue;
+    depth_hist[head - tail]++;
+    handled += head - tail;
+    for (; tail != head; tail++)
+      autoscroll_handle_event(&d->as, &q->evs[tail % QUEUE_SIZE]);
+    atomic_store_explicit(&q->tail, tail, memory_order_release);
+  }
+  return handled;
+}
+
+static void tick_all(uint64_t t_us) {
+  for (int i = 0; i < ndevices; i++) {
+    autoscroll_tick(&devices[i].as, t_us);
+    scroller_tick(&devices[i].sc, t_us);
+  }
+}
+
+static uint32_t hist_percentile(double p) {
+  uint64_t total = 0, seen = 0;
+  for (int i = 0; i <= QUEUE_SIZE; i++)
+    total += depth_hist[i];
+  for (int i = 0; i <= QUEUE_SIZE; i++) {
+    seen += depth_hist[i];
+    if (seen > 0 && seen >= total * p)
+      return i;
+  }
+  return 0;
+}
+
+static void run_paced(int n, int rate_hz, struct result *r) {
+  init_devices(n);
+  memset(depth_hist, 0, sizeof(depth_hist));
+  period_ns = 1000000000ull / rate_hz;
+  event_fd = eventfd(0, EFD_NONBLOCK);
+  int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  start_ns = now_ns() + 1000000;
+  end_ns = start_ns + seconds * 1000000000ull;
+  struct itimerspec its = {{0, TICK_INTERVAL_US * 1000},
+                           {start_ns / 1000000000, start_ns % 1000000000}};
+  timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+  uint64_t expected_us = start_ns / 1000;
+
+  atomic_store(&generating, 1);
+  pthread_t generator;
+  pthread_create(&generator, NULL, generator_main, NULL);
+  uint64_t cpu = thread_cpu_ns();
+
+  struct pollfd fds[2] = {{event_fd, POLLIN, 0}, {tfd, POLLIN, 0}};
+  while (1) {
+    if (poll(fds, 2, -1) == -1 && errno != EINTR)
+      break;
+    if (fds[0].revents & POLLIN) {
+      eventfd_t count;
+      eventfd_read(event_fd, &count);
+      int done = !atomic_load(&generating);
+      r->handled += drain();
+      if (done)
+        break;
+    }
+    if (fds[1].revents & POLLIN) {
+      uint64_t expirations;
+      read(tfd, &expirations, sizeof(expirations));
+      uint64_t t = now_ns() / 1000;
+      if (r->ticks < MAX_TICKS)
+        lateness[r->ticks++] = t > expected_us ? t - expected_us : 0;
+      expected_us += expirations * TICK_INTERVAL_US;
+      tick_all(t);
+    }
+  }
+  r->cpu_ns = thread_cpu_ns() - cpu;
+  r->wall_us = (now_ns() - start_ns) / 1000;
+  pthread_join(generator, NULL);
+  close(tfd);
+  close(event_fd);
+
+  for (int i = 0; i < n; i++) {
+    r->generated += devices[i].generated;
+    r->dropped += devices[i].dropped;
+  }
+  r->queue_p99 = hist_percentile(0.99);
+  for (int i = QUEUE_SIZE; i >= 0; i--) {
+    if (depth_hist[i]) {
+      r->queue_max = i;
+      break;
+    }
+  }
+  if (r->ticks) {
+    qsort(lateness, r->ticks, sizeof(*lateness), compare_u64);
+    r->late_p50_us = lateness[r->ticks / 2];
+    r->late_p99_us = lateness[r->ticks * 99 / 100];
+    r->late_max_us = lateness[r->ticks - 1];
+  }
+}
+
+// Events per second of CPU, handling reports of n devices at rate_hz as fast
+// as possible, with ticks on event time. Reports are generated in chunks,
+// outside the measured time. Sets *events_per_report.
+static double run_unpaced(int n, int rate_hz, double *events_per_report) {
+  init_devices(n);
+  period_ns = 1000000000ull / rate_hz;
+  start_ns = 1000000000ull;
+  size_t max = (size_t)UNPACED_CHUNK_MS * 1000000 / period_ns * n * REPORT_MAX;
+  struct input_event *evs = malloc(max * sizeof(*evs));
+  int *owner = malloc(max * sizeof(*owner));
+  if (!evs || !owner) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+
+  uint64_t t = start_ns, cpu = 0, events = 0, reports = 0;
+  uint64_t next_tick_us = start_ns / 1000 + TICK_INTERVAL_US;
+  while (cpu < UNPACED_CPU_NS) {
+    size_t count = 0;
+    uint64_t chunk_end = t + UNPACED_CHUNK_MS * 1000000ull;
+    for (; t < chunk_end; t += period_ns) {
+      for (int i = 0; i < n; i++) {
+        int k = make_report(&devices[i], t + period_ns * i / n, &evs[count]);
+        for (int j = 0; j < k; j++)
+          owner[count + j] = i;
+        count += k;
+        reports++;
+      }
+    }
+    uint64_t start = thread_cpu_ns();
+    for (size_t e = 0; e < count; e++) {
+      uint64_t t_us = evs[e].time.tv_sec * 1000000ull + evs[e].time.tv_usec;
+      for (; next_tick_us <= t_us; next_tick_us += TICK_INTERVAL_US)
+        tick_all(next_tick_us);
+      autoscroll_handle_event(&devices[owner[e]].as, &evs[e]);
+    }
+    cpu += thread_cpu_ns() - start;
+    events += count;
+  }
+  free(evs);
+  free(owner);
+  *events_per_report = (double)events / reports;
+  return events * 1e9 / cpu;
+}
+
+// Command line
+
+static int parse_list(const char *s, int *out) {
+  int n = 0;
+  char *end;
+  while (*s && n < MAX_POINTS) {
+    out[n] = strtol(s, &end, 10);
+    if (end == s || out[n] < 1)
+      return -1;
+    n++;
+    s = *end == ',' ? end + 1 : end;
+  }
+  return *s ? -1 : n;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s [-n devices,...] [-r rate_hz,...] [-d seconds]\n"
+          "          [-b button_cycle_ms] [-w wheel_interval_ms] [-c]\n",
+          name);
+}
+
+int main(int argc, char *argv[]) {
+  int opt;
+  while ((opt = getopt(argc, argv, "n:r:d:b:w:c")) != -1) {
+    switch (opt) {
+    case 'n':
+      ndevice_counts = parse_list(optarg, device_counts);
+      break;
+    case 'r':
+      nrates = parse_list(optarg, rates);
+      break;
+    case 'd':
+      seconds = atoi(optarg);
+      break;
+    case 'b':
+      button_cycle_ms = atoi(optarg);
+      break;
+    case 'w':
+      wheel_interval_ms = atoi(optarg);
+      break;
+    case 'c':
+      csv = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (ndevice_counts < 1 || nrates < 1 || seconds < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  for (int i = 0; i < ndevice_counts; i++) {
+    if (device_counts[i] > MAX_DEVICES) {
+      fprintf(stderr, "At most %d devices\n", MAX_DEVICES);
+      return 1;
+    }
+  }
+  devices = calloc(MAX_DEVICES, sizeof(*devices));
+  lateness = malloc(MAX_TICKS * sizeof(*lateness));
+  if (!devices || !lateness) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  if (csv)
+    printf("devices,rate_hz,offered_per_s,handled_per_s,dropped,"
+           "cpu_us_per_event,cpu_percent,queue_p99,queue_max,"
+           "tick_late_p50_us,tick_late_p99_us,tick_late_max_us,ok\n");
+  else
+    printf("devices  rate_hz  events/s  dropped  us/event   cpu  queue p99/max"
+           "  tick late p50/p99/max us\n");
+  for (int i = 0; i < ndevice_counts; i++) {
+    for (int j = 0; j < nrates; j++) {
+      struct result r = {0};
+      run_paced(device_counts[i], rates[j], &r);
+      double per_event = r.handled ? r.cpu_ns / 1000.0 / r.handled : 0;
+      double cpu = r.cpu_ns / 10.0 / r.wall_us;
+      // Sustained: nothing lost and ticks on time, short of the odd
+      // scheduling hiccup
+      int ok = !r.dropped && r.late_p99_us < TICK_INTERVAL_US / 2;
+      if (csv)
+        printf("%d,%d,%.0f,%.0f,%llu,%.3f,%.1f,%u,%u,%llu,%llu,%llu,%d\n",
+               device_counts[i], rates[j], r.generated * 1e6 / r.wall_us,
+               r.handled * 1e6 / r.wall_us, (unsigned long long)r.dropped,
+               per_event, cpu, r.queue_p99, r.queue_max,
+               (unsigned long long)r.late_p50_us,
+               (unsigned long long)r.late_p99_us,
+               (unsigned long long)r.late_max_us, ok);
+      else
+        printf("%7d  %7d  %8.0f  %7llu  %8.3f  %3.0f%%  %5u/%-5u    "
+               "%6llu/%6llu/%6llu%s\n",
+               device_counts[i], rates[j], r.handled * 1e6 / r.wall_us,
+               (unsigned long long)r.dropped, per_event, cpu, r.queue_p99,
+               r.queue_max, (unsigned long long)r.late_p50_us,
+               (unsigned long long)r.late_p99_us,
+               (unsigned long long)r.late_max_us, ok ? "" : "  overloaded");
+    }
+  }
+
+  // Highest rate, unpaced at the highest rate's event mix
+  int max_rate = rates[0];
+  for (int j = 1; j < nrates; j++)
+    if (rates[j] > max_rate)
+      max_rate = rates[j];
+  if (csv)
+    printf("\ndevices,max_events_per_s,max_rate_hz_per_device\n");
+  else
+    printf("\nmax sustainable (unpaced, one CPU, no device I/O):\n");
+  for (int i = 0; i < ndevice_counts; i++) {
+    int n = device_counts[i];
+    double per_report;
+    double events_per_s = run_unpaced(n, max_rate, &per_report);
+    double hz = events_per_s / per_report / n;
+    if (csv)
+      printf("%d,%.0f,%.0f\n", n, events_per_s, hz);
+    else
+      printf("%7d devices: %9.0f events/s, %7.0f Hz per device\n", n,
+             events_per_s, hz);
+  }
+  return 0;
+}
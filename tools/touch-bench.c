@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+
+// Measures the touch output (-T) on a private session bus, with a stub
+// receiver thread owning the GNOME Shell name in place of the extension.
+//
+//   dbus-run-session -- tools/touch-bench [-d seconds] [-n messages]
+//
+// throughput: Move messages sent back to back, built and flushed per message
+//   as before, then through dbus.c (non-blocking writes, no flush).
+// drag: 1 kHz pointer motion with the button held for -d seconds, in real
+//   time, sent per input report, per tick and per display frame. Latency is
+//   from the oldest and the newest input a message carries to its arrival at
+//   the receiver, p50/p99/max in ms.
+
+#include "../autoscroll.h"
+#include "../dbus.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SERIAL (1 << 21)
+
+// dbus.c
+extern DBusConnection *conn;
+extern dbus_uint32_t serial;
+
+static inline uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000ull;
+}
+
+static uint64_t thread_cpu_us(void) {
+  struct rusage ru;
+  getrusage(RUSAGE_THREAD, &ru);
+  return ru.ru_utime.tv_sec * 1000000ull + ru.ru_utime.tv_usec +
+         ru.ru_stime.tv_sec * 1000000ull + ru.ru_stime.tv_usec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Receiver
+
+DBusConnection *receiver_conn;
+uint64_t *recv_us;        // by serial
+_Atomic uint64_t received; // messages for TOUCH_INTERFACE
+atomic_int stop;
+
+static void *receiver_main(void *data) {
+  while (!atomic_load(&stop) && dbus_connection_read_write(receiver_conn, 50)) {
+    DBusMessage *m;
+    while ((m = dbus_connection_pop_message(receiver_conn))) {
+      uint64_t t = now_us();
+      if (dbus_message_has_interface(m, TOUCH_INTERFACE)) {
+        dbus_uint32_t s = dbus_message_get_serial(m);
+        if (s < MAX_SERIAL)
+          recv_us[s] = t;
+        atomic_fetch_add_explicit(&received, 1, memory_order_release);
+      }
+      dbus_message_unref(m);
+    }
+  }
+  return NULL;
+}
+
+static int start_receiver(pthread_t *thread) {
+  DBusError err;
+  dbus_error_init(&err);
+  receiver_conn = dbus_bus_get_private(DBUS_BUS_SESSION, &err);
+  if (!receiver_conn) {
+    fprintf(stderr, "DBus: %s\n", err.message);
+    return -1;
+  }
+  dbus_connection_set_exit_on_disconnect(receiver_conn, FALSE);
+  int rc = dbus_bus_request_name(receiver_conn, TOUCH_DESTINATION,
+                                 DBUS_NAME_FLAG_DO_NOT_QUEUE, &err);
+  if (rc != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
+    fprintf(stderr, "Can't own %s, run under dbus-run-session\n",
+            TOUCH_DESTINATION);
+    return -1;
+  }
+  return pthread_create(thread, NULL, receiver_main, NULL);
+}
+
+// Wait until the receiver has seen count messages in total
+static int wait_received(uint64_t count) {
+  dbus_connection_flush(conn);
+  uint64_t deadline = now_us() + 10000000;
+  while (atomic_load_explicit(&received, memory_order_acquire) < count) {
+    if (now_us() > deadline) {
+      fprintf(stderr, "Receiver got %llu of %llu messages\n",
+              (unsigned long long)atomic_load(&received),
+              (unsigned long long)count);
+      return -1;
+    }
+    struct timespec ts = {0, 1000000};
+    nanosleep(&ts, NULL);
+  }
+  return 0;
+}
+
+// Throughput
+
+// As send_dbus_message() did before: build, send and flush every message.
+// Without a reply, the bus would stop it at 50000 pending replies.
+static void blocking_move(int dx, int dy) {
+  DBusMessage *m = dbus_message_new_method_call(TOUCH_DESTINATION, TOUCH_PATH,
+                                                TOUCH_INTERFACE, "Move");
+  dbus_message_set_no_reply(m, TRUE);
+  dbus_int32_t x = dx, y = dy;
+  dbus_message_append_args(m, DBUS_TYPE_INT32, &x, DBUS_TYPE_INT32, &y,
+                           DBUS_TYPE_INVALID);
+  dbus_connection_send(conn, m, &serial);
+  dbus_connection_flush(conn);
+  dbus_message_unref(m);
+}
+
+static void run_throughput(const char *name, void (*move)(int, int),
+                           long count) {
+  uint64_t base = atomic_load(&received);
+  uint64_t cpu = thread_cpu_us(), start = now_us();
+  for (long i = 0; i < count; i++)
+    move(1, -1);
+  uint64_t sent = now_us() - start;
+  cpu = thread_cpu_us() - cpu;
+  if (wait_received(base + count) < 0)
+    exit(1);
+  uint64_t done = now_us() - start;
+  printf("%-13s %8.0f msg/s sent %8.0f msg/s received %6.2f us cpu/msg\n",
+         name, count * 1e6 / sent, count * 1e6 / done, (double)cpu / count);
+}
+
+// Drag
+
+enum { PER_REPORT, PER_TICK, PER_FRAME };
+
+struct autoscroll as;
+struct scroller scroller;
+int mode;
+uint64_t input_us;  // oldest input not sent yet, 0 if none
+uint64_t newest_us; // newest input
+dbus_uint32_t last_serial;
+uint64_t *origin_us, *newest_origin_us; // by serial
+
+static void bench_write(void *data, int device, unsigned int type,
+                        unsigned int code, int value) {
+  if (device == OUTPUT_TOUCH)
+    touch_write(type, code, value);
+}
+
+static void bench_sleep(void *data, uint64_t us) {}
+
+// Attribute messages sent since the last call to the pending input
+static void note_sent(void) {
+  for (dbus_uint32_t s = last_serial + 1; s <= serial; s++) {
+    if (s < MAX_SERIAL) {
+      origin_us[s] = input_us;
+      newest_origin_us[s] = newest_us;
+    }
+  }
+  if (serial != last_serial)
+    input_us = 0;
+  last_serial = serial;
+}
+
+static void input(uint64_t t, int type, int code, int value) {
+  if (!input_us)
+    input_us = t;
+  newest_us = t;
+  if (mode == PER_REPORT) {
+    if (type == EV_KEY)
+      touch_write(EV_KEY, BTN_TOUCH, value);
+    else
+      touch_write(type, code, value);
+  } else {
+    struct input_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.time.tv_sec = t / 1000000;
+    ev.time.tv_usec = t % 1000000;
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    autoscroll_handle_event(&as, &ev);
+  }
+}
+
+// Receive time minus origin of the messages since first, p50/p99/max in ms
+static void print_latency(const char *label, const uint64_t *origin,
+                          dbus_uint32_t first) {
+  uint64_t *latency = malloc((serial - first + 1) * sizeof(*latency));
+  long n = 0;
+  for (dbus_uint32_t s = first; s <= serial && s < MAX_SERIAL; s++) {
+    if (origin[s])
+      latency[n++] = recv_us[s] - origin[s];
+  }
+  qsort(latency, n, sizeof(*latency), cmp_u64);
+  printf(" %s %5.2f/%5.2f/%5.2f", label, latency[n / 2] / 1000.0,
+         latency[n * 99 / 100] / 1000.0, latency[n - 1] / 1000.0);
+  free(latency);
+}
+
+static void sleep_until(uint64_t t) {
+  struct timespec ts = {t / 1000000, (t % 1000000) * 1000};
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static void run_drag(const char *name, int drag_mode, double frame_us,
+                     int seconds) {
+  struct autoscroll_params params = AUTOSCROLL_DEFAULT_PARAMS;
+  params.touch = 1;
+  params.touch_frame_us = frame_us;
+  struct autoscroll_output output = {bench_write, bench_sleep, NULL};
+  scroller_init(&scroller, &params, &output);
+  autoscroll_init(&as, &params, scroller_post, &scroller);
+  mode = drag_mode;
+  input_us = 0;
+  last_serial = serial;
+  dbus_uint32_t first = serial + 1;
+  uint64_t base = atomic_load(&received);
+
+  uint64_t cpu = thread_cpu_us(), start = now_us() + 1000;
+  uint64_t end_ms = seconds * 1000, next_tick = start;
+  for (uint64_t ms = 0; ms <= end_ms;) {
+    uint64_t next_input = start + ms * 1000;
+    if (next_tick < next_input) {
+      sleep_until(next_tick);
+      scroller_tick(&scroller, now_us());
+      touch_tick();
+      next_tick += TICK_INTERVAL_US;
+    } else {
+      sleep_until(next_input);
+      uint64_t t = now_us();
+      if (ms == 0)
+        input(t, EV_KEY, BTN_LEFT, 1), input(t, EV_SYN, SYN_REPORT, 0);
+      input(t, EV_REL, REL_X, (ms / 250) % 2 ? 3 : -3);
+      input(t, EV_REL, REL_Y, (ms / 400) % 2 ? 2 : -2);
+      input(t, EV_SYN, SYN_REPORT, 0);
+      if (ms == end_ms)
+        input(t, EV_KEY, BTN_LEFT, 0), input(t, EV_SYN, SYN_REPORT, 0);
+      ms++;
+    }
+    note_sent();
+  }
+  cpu = thread_cpu_us() - cpu;
+  uint64_t wall = now_us() - start;
+
+  long count = serial - first + 1;
+  if (wait_received(base + count) < 0)
+    exit(1);
+  printf("%-13s %6ld msgs %6.1f msg/s %5.1f%% cpu  latency", name, count,
+         count * 1e6 / wall, cpu * 100.0 / wall);
+  print_latency("oldest", origin_us, first);
+  print_latency("newest", newest_origin_us, first);
+  printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+  int seconds = 5;
+  long count = 100000;
+  int opt;
+  while ((opt = getopt(argc, argv, "d:n:")) != -1) {
+    switch (opt) {
+    case 'd':
+      seconds = atoi(optarg);
+      break;
+    case 'n':
+      count = atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-d seconds] [-n messages]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (seconds < 1 || count < 1 || count > MAX_SERIAL / 4) {
+    fprintf(stderr, "Seconds and messages must be positive, messages at most "
+                    "%d\n",
+            MAX_SERIAL / 4);
+    return 1;
+  }
+
+  dbus_threads_init_default();
+  recv_us = calloc(MAX_SERIAL, sizeof(*recv_us));
+  origin_us = calloc(MAX_SERIAL, sizeof(*origin_us));
+  newest_origin_us = calloc(MAX_SERIAL, sizeof(*newest_origin_us));
+  pthread_t receiver;
+  if (start_receiver(&receiver) < 0 || connect_dbus() < 0)
+    return 1;
+
+  run_throughput("blocking", blocking_move, count);
+  run_throughput("non-blocking", touch_move, count);
+  run_drag("per report", PER_REPORT, 0, seconds);
+  run_drag("per tick", PER_TICK, 0, seconds);
+  run_drag("per frame", PER_FRAME, 16667, seconds);
+
+  atomic_store(&stop, 1);
+  pthread_join(receiver, NULL);
+  return 0;
+}
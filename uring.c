@@ -0,0 +1,367 @@
+#define _GNU_SOURCE
+
+#include "uring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TAG_READ 1
+#define TAG_TICK 2
+#define TAG_CHAIN 3
+
+#define SLEEP_DEVICE -1
+
+static int check_ops(struct uring_loop *l);
+
+static inline uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000ull;
+}
+
+int uring_loop_init(struct uring_loop *l, int dev_fd, const int out_fds[2]) {
+  memset(l, 0, sizeof(*l));
+  l->dev_fd = dev_fd;
+  l->out_fds[0] = out_fds[0];
+  l->out_fds[1] = out_fds[1];
+
+  // Completion work only runs inside our io_uring_enter() calls, instead
+  // of interrupting the thread (6.1+)
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+  l->ring_fd = syscall(__NR_io_uring_setup, URING_QUEUE_SIZE, &p);
+  if (l->ring_fd < 0 && errno == EINVAL) {
+    memset(&p, 0, sizeof(p));
+    l->ring_fd = syscall(__NR_io_uring_setup, URING_QUEUE_SIZE, &p);
+  }
+  if (l->ring_fd < 0)
+    return -errno;
+  if (!(p.features & IORING_FEAT_SINGLE_MMAP)) { // before 5.4
+    close(l->ring_fd);
+    return -ENOSYS;
+  }
+
+  size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  l->ring_size = sq_size > cq_size ? sq_size : cq_size;
+  l->ring = mmap(NULL, l->ring_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, l->ring_fd, IORING_OFF_SQ_RING);
+  l->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  l->sqes = mmap(NULL, l->sqes_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, l->ring_fd, IORING_OFF_SQES);
+  if (l->ring == MAP_FAILED || l->sqes == MAP_FAILED) {
+    int err = -errno;
+    close(l->ring_fd);
+    return err;
+  }
+
+  char *ring = l->ring;
+  l->sq_head = (_Atomic unsigned *)(ring + p.sq_off.head);
+  l->sq_tail = (_Atomic unsigned *)(ring + p.sq_off.tail);
+  l->sq_mask = *(unsigned *)(ring + p.sq_off.ring_mask);
+  l->sq_entries = p.sq_entries;
+  l->sq_array = (unsigned *)(ring + p.sq_off.array);
+  l->cq_head = (_Atomic unsigned *)(ring + p.cq_off.head);
+  l->cq_tail = (_Atomic unsigned *)(ring + p.cq_off.tail);
+  l->cq_mask = *(unsigned *)(ring + p.cq_off.ring_mask);
+  l->cqes = (struct io_uring_cqe *)(ring + p.cq_off.cqes);
+
+  int rc = check_ops(l);
+  if (rc < 0) {
+    uring_loop_free(l);
+    return rc;
+  }
+
+  // A read on an O_NONBLOCK file completes with -EAGAIN instead of waiting
+  int flags = fcntl(dev_fd, F_GETFL);
+  if (flags >= 0)
+    fcntl(dev_fd, F_SETFL, flags & ~O_NONBLOCK);
+  return 0;
+}
+
+void uring_loop_free(struct uring_loop *l) {
+  munmap(l->sqes, l->sqes_size);
+  munmap(l->ring, l->ring_size);
+  close(l->ring_fd);
+}
+
+// Submit queued SQEs, waiting for `wait` completions. Returns -errno.
+static int enter(struct uring_loop *l, unsigned wait) {
+  while (1) {
+    l->stats.enters++;
+    int rc = syscall(__NR_io_uring_enter, l->ring_fd, l->to_submit, wait,
+                     wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (rc >= 0) {
+      l->to_submit -= rc;
+      return 0;
+    }
+    if (errno != EINTR)
+      return -errno;
+  }
+}
+
+// The kernel only reads SQEs inside io_uring_enter(), so an entry can be
+// published before it is filled in
+static struct io_uring_sqe *get_sqe(struct uring_loop *l) {
+  unsigned tail = atomic_load_explicit(l->sq_tail, memory_order_relaxed);
+  while (tail - atomic_load_explicit(l->sq_head, memory_order_acquire) >=
+         l->sq_entries)
+    enter(l, 0);
+  unsigned index = tail & l->sq_mask;
+  struct io_uring_sqe *sqe = &l->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  l->sq_array[index] = index;
+  atomic_store_explicit(l->sq_tail, tail + 1, memory_order_release);
+  l->to_submit++;
+  return sqe;
+}
+
+static void arm_read(struct uring_loop *l) {
+  struct io_uring_sqe *sqe = get_sqe(l);
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = l->dev_fd;
+  sqe->addr = (uintptr_t)l->in;
+  sqe->len = sizeof(l->in);
+  sqe->off = (uint64_t)-1; // current position
+  sqe->user_data = TAG_READ;
+}
+
+static void arm_tick(struct uring_loop *l) {
+  l->deadline.tv_sec = l->deadline_us / 1000000;
+  l->deadline.tv_nsec = (l->deadline_us % 1000000) * 1000;
+  struct io_uring_sqe *sqe = get_sqe(l);
+  sqe->opcode = IORING_OP_TIMEOUT;
+  sqe->addr = (uintptr_t)&l->deadline;
+  sqe->len = 1;
+  sqe->timeout_flags = IORING_TIMEOUT_ABS;
+  sqe->user_data = TAG_TICK;
+}
+
+// Submit the pending output as one linked chain. Only call with no chain in
+// flight.
+static void submit_chain(struct uring_loop *l) {
+  struct uring_out *o = &l->out[l->pending];
+  if (!o->n)
+    return;
+
+  struct io_uring_sqe *sqe = NULL;
+  for (int i = 0; i < o->n;) {
+    sqe = get_sqe(l);
+    if (o->devices[i] == SLEEP_DEVICE) {
+      sqe->opcode = IORING_OP_TIMEOUT;
+      sqe->addr = (uintptr_t)&o->sleeps[o->evs[i].value];
+      sqe->len = 1;
+      // Expiring is this timeout's success, don't cancel the rest
+      sqe->timeout_flags = IORING_TIMEOUT_ETIME_SUCCESS;
+      i++;
+    } else {
+      int j = i + 1;
+      while (j < o->n && o->devices[j] == o->devices[i])
+        j++;
+      sqe->opcode = IORING_OP_WRITE;
+      sqe->fd = l->out_fds[(int)o->devices[i]];
+      sqe->addr = (uintptr_t)&o->evs[i];
+      sqe->len = (j - i) * sizeof(*o->evs);
+      sqe->off = (uint64_t)-1;
+      i = j;
+    }
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = TAG_CHAIN;
+    l->chain_inflight++;
+  }
+  sqe->flags = 0; // end of chain
+  l->stats.chains++;
+
+  l->pending ^= 1;
+  l->out[l->pending].n = 0;
+  l->out[l->pending].nsleeps = 0;
+}
+
+// Take the next completion, deferred ones first
+static int next_cqe(struct uring_loop *l, struct io_uring_cqe *cqe) {
+  if (l->ndeferred) {
+    *cqe = l->deferred[0];
+    memmove(l->deferred, l->deferred + 1,
+            --l->ndeferred * sizeof(*l->deferred));
+    return 1;
+  }
+  unsigned head = atomic_load_explicit(l->cq_head, memory_order_relaxed);
+  if (head == atomic_load_explicit(l->cq_tail, memory_order_acquire))
+    return 0;
+  *cqe = l->cqes[head & l->cq_mask];
+  atomic_store_explicit(l->cq_head, head + 1, memory_order_release);
+  return 1;
+}
+
+// The ring can be set up on kernels that can't run the loop: reads need 5.6
+// and sleeps in a chain need IORING_TIMEOUT_ETIME_SUCCESS (5.16). Older
+// kernels fail such a timeout with -EINVAL, which cancels the rest of its
+// chain and would leave keys held down.
+static int check_ops(struct uring_loop *l) {
+  static const int ops[] = {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_TIMEOUT};
+  struct {
+    struct io_uring_probe probe;
+    struct io_uring_probe_op ops[IORING_OP_LAST];
+  } p;
+  memset(&p, 0, sizeof(p));
+  if (syscall(__NR_io_uring_register, l->ring_fd, IORING_REGISTER_PROBE, &p,
+              IORING_OP_LAST) < 0) // before 5.6
+    return -errno;
+  for (size_t i = 0; i < sizeof(ops) / sizeof(*ops); i++) {
+    if (ops[i] > p.probe.last_op ||
+        !(p.probe.ops[ops[i]].flags & IO_URING_OP_SUPPORTED))
+      return -EOPNOTSUPP;
+  }
+
+  struct __kernel_timespec zero = {0, 0};
+  struct io_uring_sqe *sqe = get_sqe(l);
+  sqe->opcode = IORING_OP_TIMEOUT;
+  sqe->addr = (uintptr_t)&zero;
+  sqe->len = 1;
+  sqe->timeout_flags = IORING_TIMEOUT_ETIME_SUCCESS;
+  int rc = enter(l, 1);
+  if (rc < 0)
+    return rc;
+  struct io_uring_cqe cqe;
+  if (!next_cqe(l, &cqe))
+    return -EIO;
+  return cqe.res == -ETIME ? 0 : -EOPNOTSUPP;
+}
+
+// Block until the in-flight chain is done. Other completions are kept for
+// the main loop, at most one read and one tick can be outstanding.
+static void wait_chain(struct uring_loop *l) {
+  while (l->chain_inflight) {
+    if (enter(l, 1) < 0)
+      return;
+    unsigned head = atomic_load_explicit(l->cq_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(l->cq_tail, memory_order_acquire);
+    for (; head != tail; head++) {
+      struct io_uring_cqe *cqe = &l->cqes[head & l->cq_mask];
+      if (cqe->user_data == TAG_CHAIN)
+        l->chain_inflight--;
+      else
+        l->deferred[l->ndeferred++] = *cqe;
+    }
+    atomic_store_explicit(l->cq_head, head, memory_order_release);
+  }
+}
+
+// Make room in the pending output
+static struct uring_out *out_reserve(struct uring_loop *l, int sleep) {
+  struct uring_out *o = &l->out[l->pending];
+  if (o->n == URING_OUT_EVENTS || (sleep && o->nsleeps == URING_OUT_SLEEPS)) {
+    wait_chain(l);
+    submit_chain(l);
+    o = &l->out[l->pending];
+  }
+  return o;
+}
+
+void uring_loop_write(void *data, int device, unsigned int type,
+                      unsigned int code, int value) {
+  struct uring_loop *l = data;
+  struct uring_out *o = out_reserve(l, 0);
+  // Zero time, the kernel stamps uinput events like libevdev's writes
+  memset(&o->evs[o->n], 0, sizeof(*o->evs));
+  o->evs[o->n].type = type;
+  o->evs[o->n].code = code;
+  o->evs[o->n].value = value;
+  o->devices[o->n++] = device;
+}
+
+void uring_loop_sleep(void *data, uint64_t us) {
+  struct uring_loop *l = data;
+  struct uring_out *o = out_reserve(l, 1);
+  o->sleeps[o->nsleeps].tv_sec = us / 1000000;
+  o->sleeps[o->nsleeps].tv_nsec = (us % 1000000) * 1000;
+  memset(&o->evs[o->n], 0, sizeof(*o->evs));
+  o->evs[o->n].value = o->nsleeps++;
+  o->devices[o->n++] = SLEEP_DEVICE;
+}
+
+static void handle_read(struct uring_loop *l, int n) {
+  for (int i = 0; i < n; i++) {
+    const struct input_event *ev = &l->in[i];
+    // The kernel dropped events: skip the rest of this report, as
+    // libevdev's normal mode does (without resyncing key state)
+    if (ev->type == EV_SYN && ev->code == SYN_DROPPED) {
+      l->dropped = 1;
+      continue;
+    }
+    if (l->dropped) {
+      if (ev->type == EV_SYN && ev->code == SYN_REPORT)
+        l->dropped = 0;
+      continue;
+    }
+    l->on_event(l->data, ev);
+  }
+  l->stats.events += n;
+  if (l->on_batch)
+    l->on_batch(l->data);
+}
+
+int uring_loop_run(struct uring_loop *l) {
+  arm_read(l);
+  if (l->tick_interval_us) {
+    l->deadline_us = now_us() + l->tick_interval_us;
+    arm_tick(l);
+  }
+
+  while (1) {
+    // Writes usually complete during submission. Wait for them and one
+    // more completion, unless output is pending behind the chain.
+    if (!l->chain_inflight)
+      submit_chain(l);
+    unsigned wait = l->chain_inflight;
+    if (!l->out[l->pending].n)
+      wait++;
+    int rc = enter(l, wait);
+    if (rc < 0) {
+      fprintf(stderr, "io_uring_enter: %s\n", strerror(-rc));
+      return rc;
+    }
+    l->stats.wakeups++;
+
+    struct io_uring_cqe cqe;
+    while (next_cqe(l, &cqe)) {
+      switch (cqe.user_data) {
+      case TAG_READ:
+        if (cqe.res == 0) { // device gone, finish writing
+          wait_chain(l);
+          submit_chain(l);
+          wait_chain(l);
+          return 0;
+        }
+        if (cqe.res < 0 && cqe.res != -EINTR && cqe.res != -EAGAIN) {
+          fprintf(stderr, "Device read failed: %s\n", strerror(-cqe.res));
+          return cqe.res;
+        }
+        if (cqe.res > 0)
+          handle_read(l, cqe.res / sizeof(*l->in));
+        arm_read(l);
+        break;
+      case TAG_TICK: {
+        uint64_t t = now_us();
+        l->stats.ticks++;
+        l->on_tick(l->data, t);
+        l->deadline_us += l->tick_interval_us;
+        if (l->deadline_us <= t) // missed whole frames, don't catch up
+          l->deadline_us = t + l->tick_interval_us;
+        arm_tick(l);
+        break;
+      }
+      case TAG_CHAIN:
+        // Write errors are ignored, as with libevdev_uinput_write_event()
+        l->chain_inflight--;
+        break;
+      }
+    }
+  }
+}
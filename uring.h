@@ -0,0 +1,95 @@
+#ifndef URING_H
+#define URING_H
+
+// Alternative event loop built on io_uring (raw syscalls, no liburing).
+// Everything queued during a wakeup (the re-armed device read, the next frame
+// timeout, output writes) is submitted by the same io_uring_enter() that
+// waits for the next completion, so a typical wakeup costs one syscall
+// instead of poll() + read()s + timerfd read() + one write() per event.
+//
+// - The device is read with IORING_OP_READ, re-armed as soon as it completes.
+// - Frames are absolute IORING_OP_TIMEOUTs on CLOCK_MONOTONIC instead of a
+//   timerfd.
+// - Output events are buffered and submitted as one linked chain per wakeup,
+//   one write per run of events for the same device. Sleeps become timeouts
+//   inside the chain instead of blocking the loop. Only one chain is in
+//   flight at a time, so output stays in order.
+
+#include <linux/input.h>
+#include <linux/io_uring.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define URING_QUEUE_SIZE 512 // always fits a full chain plus read and tick
+#define URING_READ_EVENTS 64
+#define URING_OUT_EVENTS 256
+#define URING_OUT_SLEEPS 32
+
+struct uring_stats {
+  uint64_t enters;  // io_uring_enter() calls
+  uint64_t wakeups; // enters that returned with completions
+  uint64_t events;  // device events read
+  uint64_t ticks;
+  uint64_t chains; // output chains submitted
+};
+
+// Output events for one chain. devices[i] < 0 marks a sleep, with
+// evs[i].value indexing sleeps[].
+struct uring_out {
+  struct input_event evs[URING_OUT_EVENTS];
+  signed char devices[URING_OUT_EVENTS];
+  int n;
+  struct __kernel_timespec sleeps[URING_OUT_SLEEPS];
+  int nsleeps;
+};
+
+struct uring_loop {
+  // Callbacks, set after uring_loop_init()
+  void (*on_event)(void *data, const struct input_event *ev);
+  void (*on_batch)(void *data); // after each read, may be NULL
+  void (*on_tick)(void *data, uint64_t now_us);
+  void *data;
+  uint64_t tick_interval_us; // 0: no frames
+
+  int ring_fd;
+  _Atomic unsigned *sq_head, *sq_tail, *cq_head, *cq_tail;
+  unsigned sq_mask, sq_entries, cq_mask;
+  unsigned *sq_array;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *ring;
+  size_t ring_size, sqes_size;
+  unsigned to_submit;
+
+  int dev_fd;
+  int out_fds[2]; // indexed by OUTPUT_MOUSE, OUTPUT_KEYBOARD
+  struct input_event in[URING_READ_EVENTS];
+  int dropped; // skipping events after SYN_DROPPED
+  struct __kernel_timespec deadline;
+  uint64_t deadline_us;
+
+  struct uring_out out[2]; // pending and in flight
+  int pending;
+  int chain_inflight; // SQEs of the in-flight chain not completed yet
+
+  // Completions reaped while waiting for a chain, handled next
+  struct io_uring_cqe deferred[4];
+  int ndeferred;
+
+  struct uring_stats stats;
+};
+
+// Returns -errno if io_uring is unavailable or lacks an operation the loop
+// needs, so the caller can fall back to poll(). Clears O_NONBLOCK on dev_fd.
+int uring_loop_init(struct uring_loop *l, int dev_fd, const int out_fds[2]);
+void uring_loop_free(struct uring_loop *l);
+
+// Run until the device goes away (0) or an error (-errno)
+int uring_loop_run(struct uring_loop *l);
+
+// struct autoscroll_output callbacks, data is a struct uring_loop
+void uring_loop_write(void *data, int device, unsigned int type,
+                      unsigned int code, int value);
+void uring_loop_sleep(void *data, uint64_t us);
+
+#endif